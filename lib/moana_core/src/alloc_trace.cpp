@@ -0,0 +1,83 @@
+#include "alloc_trace.h"
+
+#include <string.h>
+
+/**
+ * @brief Clears the counters and starts counting (once setup() is done)
+ */
+void allocTraceArm(AllocTrace& trace) {
+  memset(&trace, 0, sizeof(trace));
+  trace.armed = true;
+}
+
+/**
+ * @brief Finds the task's counters, adding them on its first allocation or free
+ */
+static AllocTaskCount* findTask(AllocTrace& trace, const void* task, const char* taskName) {
+  for (int i = 0; i < trace.taskCount; i++) {
+    if (trace.tasks[i].task == task) {
+      return &trace.tasks[i];
+    }
+  }
+  if (trace.taskCount == ALLOC_TRACE_TASKS) {
+    return NULL;
+  }
+  AllocTaskCount& entry = trace.tasks[trace.taskCount++];
+  entry.task = task;
+  strncpy(entry.name, taskName ? taskName : "?", ALLOC_TRACE_NAME_LEN - 1);
+  return &entry;
+}
+
+/**
+ * @brief Counts an allocation of size bytes made by task from caller
+ */
+void allocTraceRecordAlloc(AllocTrace& trace, const void* task, const char* taskName, size_t size, const void* caller) {
+  if (!trace.armed) {
+    return;
+  }
+  AllocTaskCount* entry = findTask(trace, task, taskName);
+  if (entry) {
+    entry->allocs++;
+    entry->bytes += size;
+  } else {
+    trace.otherAllocs++;
+  }
+  AllocRecord& record = trace.log[trace.allocs % ALLOC_TRACE_SLOTS];
+  record.task = task;
+  record.caller = caller;
+  record.size = size;
+  trace.allocs++;
+}
+
+/**
+ * @brief Counts a free made by task (blocks are often freed by another task than their owner)
+ */
+void allocTraceRecordFree(AllocTrace& trace, const void* task, const char* taskName) {
+  if (!trace.armed) {
+    return;
+  }
+  AllocTaskCount* entry = findTask(trace, task, taskName);
+  if (entry) {
+    entry->frees++;
+  }
+}
+
+/**
+ * @brief Counters of one task, NULL if it has not touched the heap since arming
+ */
+const AllocTaskCount* allocTraceTask(const AllocTrace& trace, const void* task) {
+  for (int i = 0; i < trace.taskCount; i++) {
+    if (trace.tasks[i].task == task) {
+      return &trace.tasks[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Name a task had when it was first counted ("?" if it is not in the table)
+ */
+const char* allocTraceTaskName(const AllocTrace& trace, const void* task) {
+  const AllocTaskCount* entry = allocTraceTask(trace, task);
+  return entry ? entry->name : "?";
+}
@@ -0,0 +1,48 @@
+/*
+ * Heap allocation trace for the Play mode no-allocation rule. The firmware
+ * feeds it from link-time wrappers around the allocator (MOANA_ALLOC_TRACE
+ * in src/main.cpp), from whichever task allocates: the loop, the esp_timer
+ * task running the IR frame clock, the supply task, Bluedroid's BTC task
+ * and so on. Allocations and frees are counted per task and the most
+ * recent allocations keep their caller address for addr2line.
+ *
+ * Nothing here allocates or locks; the caller serializes the calls.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+const int ALLOC_TRACE_TASKS = 8;       // Tasks counted separately, later ones go to otherAllocs
+const int ALLOC_TRACE_SLOTS = 8;       // Most recent allocations kept with their caller
+const int ALLOC_TRACE_NAME_LEN = 16;   // configMAX_TASK_NAME_LEN
+
+struct AllocTaskCount {
+  const void* task;                    // Task handle, NULL before the scheduler runs
+  char name[ALLOC_TRACE_NAME_LEN];
+  uint32_t allocs;
+  uint32_t frees;
+  uint32_t bytes;                      // Requested by its allocations
+};
+
+struct AllocRecord {
+  const void* task;
+  const void* caller;
+  uint32_t size;
+};
+
+struct AllocTrace {
+  bool armed;
+  AllocTaskCount tasks[ALLOC_TRACE_TASKS];
+  int taskCount;
+  uint32_t otherAllocs;                // From tasks that did not fit the table
+  uint32_t allocs;                     // All tasks
+  AllocRecord log[ALLOC_TRACE_SLOTS];  // Ring, indexed by allocs
+  uint32_t reported;                   // allocs at the last report
+};
+
+void allocTraceArm(AllocTrace& trace);
+void allocTraceRecordAlloc(AllocTrace& trace, const void* task, const char* taskName, size_t size, const void* caller);
+void allocTraceRecordFree(AllocTrace& trace, const void* task, const char* taskName);
+const AllocTaskCount* allocTraceTask(const AllocTrace& trace, const void* task);
+const char* allocTraceTaskName(const AllocTrace& trace, const void* task);
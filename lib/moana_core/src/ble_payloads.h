@@ -0,0 +1,23 @@
+/*
+ * BLE spam payloads shared by the Arduino and ESP-IDF builds.
+ *
+ * EVILAPPLEJ UICE-ESP32 BLE SPAM IMPLEMENTATION
+ * Adapted from: https://github.com/ckcr4lyf/EvilAppleJuice-ESP32
+ */
+#pragma once
+
+#include <stdint.h>
+
+// Device families picked from when cycling the advertisement. Payloads are
+// sent straight from these tables, so picking one never allocates (the BLE
+// stack still does when the payload is advertised).
+struct BLEDeviceFamily {
+  const char* name;
+  const uint8_t* packets;
+  uint8_t stride;   // Size of one table row
+  uint8_t length;   // Bytes of the row that are advertised
+  int count;
+};
+
+extern const BLEDeviceFamily BLE_DEVICE_FAMILIES[];
+extern const int NUM_BLE_DEVICE_FAMILIES;
@@ -0,0 +1,222 @@
+#include "console.h"
+
+#include <string.h>
+
+/**
+ * @brief Adds one received character, returns true when line.text holds a complete line
+ */
+bool consoleLineFeed(ConsoleLine& line, int c) {
+  if (c == '\r' || c == '\n') {
+    if (line.length == 0) {
+      return false;
+    }
+    line.text[line.length] = '\0';
+    line.length = 0;
+    return true;
+  }
+  if (line.length < sizeof(line.text) - 1) {
+    line.text[line.length++] = (char)c;
+  }
+  return false;
+}
+
+/**
+ * @brief Executes one command line (state changes and copies under ctx.lock, printing outside it)
+ */
+void consoleExecute(char* line, const ConsoleContext& ctx) {
+  IRSweep& sweep = *ctx.sweep;
+  char* saveptr = nullptr;
+  char* command = strtok_r(line, " ", &saveptr);
+  char* arg1 = strtok_r(nullptr, " ", &saveptr);
+  char* arg2 = strtok_r(nullptr, " ", &saveptr);
+
+  if (!command) {
+    return;
+  }
+
+  if (strcmp(command, "help") == 0) {
+    consolePrintf("Commands:\n");
+    consolePrintf("  pacing                 - show pacing sets A and B\n");
+    consolePrintf("  set <key> <value>      - change set A (gap|short|long|order)\n");
+    consolePrintf("  setb <key> <value>     - change set B\n");
+    consolePrintf("  save                   - store both sets in NVS\n");
+    consolePrintf("  ab [on|off|reset]      - A/B benchmark, no argument prints results\n");
+    consolePrintf("  stats [reset]          - lifetime usage counters\n");
+    consolePrintf("  supply                 - battery margin and IR drive level\n");
+  } else if (strcmp(command, "pacing") == 0) {
+    IRPacing sets[2];
+    ctx.lock();
+    memcpy(sets, sweep.pacingSets, sizeof(sets));
+    ctx.unlock();
+    printPacingSet("Set A", sets[PACING_SET_A]);
+    printPacingSet("Set B", sets[PACING_SET_B]);
+  } else if (strcmp(command, "set") == 0 || strcmp(command, "setb") == 0) {
+    int target = (strcmp(command, "set") == 0) ? PACING_SET_A : PACING_SET_B;
+    ctx.lock();
+    bool changed = setPacingParam(sweep.pacingSets[target], arg1, arg2);
+    if (changed && target == sweep.activePacingSet) {
+      irSweepApplyOrder(sweep);
+      sweep.sweepStarted = false; // The running sweep no longer measures one set
+    }
+    IRPacing pacing = sweep.pacingSets[target];
+    ctx.unlock();
+    if (changed) {
+      printPacingSet(target == PACING_SET_A ? "Set A" : "Set B", pacing);
+    } else {
+      consolePrintf("Invalid parameter - see help\n");
+    }
+  } else if (strcmp(command, "save") == 0) {
+    ctx.lock();
+    bool saved = ctx.savePacing();
+    ctx.unlock();
+    consolePrintf(saved ? "IR pacing saved to NVS\n" : "Failed to save IR pacing!\n");
+  } else if (strcmp(command, "ab") == 0) {
+    bool on = arg1 && strcmp(arg1, "on") == 0;
+    bool reset = arg1 && strcmp(arg1, "reset") == 0;
+    IRSweep report;
+    ctx.lock();
+    if (on || (arg1 && strcmp(arg1, "off") == 0)) {
+      irSweepSetAbMode(sweep, on);
+    } else if (reset) {
+      irSweepResetStats(sweep);
+    }
+    report = sweep;
+    ctx.unlock();
+    if (on) {
+      consolePrintf("A/B mode ON - sets alternate every sweep\n");
+    } else if (reset) {
+      consolePrintf("A/B results cleared\n");
+    } else {
+      printAbReport(report);
+    }
+  } else if (strcmp(command, "stats") == 0) {
+    bool reset = arg1 && strcmp(arg1, "reset") == 0;
+    UsageTracker usage;
+    ctx.lock();
+    if (reset) {
+      memset(&ctx.usage->stats, 0, sizeof(ctx.usage->stats));
+      ctx.flushUsageStats();
+    }
+    usage = *ctx.usage;
+    ctx.unlock();
+    if (reset) {
+      consolePrintf("Usage statistics cleared\n");
+    } else {
+      printUsageStats(usage);
+    }
+  } else if (strcmp(command, "supply") == 0) {
+    ctx.lock();
+    SupplyMonitor supply = *ctx.supply;
+    ctx.unlock();
+    printSupplyStatus(supply);
+  } else {
+    consolePrintf("Unknown command: %s\n", command);
+  }
+}
+
+/**
+ * @brief Prints one pacing set
+ */
+void printPacingSet(const char* label, const IRPacing& pacing) {
+  consolePrintf("%s: gap=%ums short=%u long=%u order=%s\n", label,
+                (unsigned)pacing.frameGapMs, (unsigned)pacing.shortPressRepeats,
+                (unsigned)pacing.longPressRepeats, SWEEP_ORDER_NAMES[pacing.sweepOrder]);
+}
+
+/**
+ * @brief Prints the sweep time and frame cadence measured for each set
+ */
+void printAbReport(const IRSweep& sweep) {
+  consolePrintf("A/B mode: %s\n", sweep.abModeEnabled ? "ON" : "OFF");
+  for (int i = 0; i < 2; i++) {
+    const PacingStats& stats = sweep.pacingStats[i];
+    consolePrintf("%s: %u sweeps, avg sweep %lu ms, frame cadence avg %lu us (min %u, max %u)\n",
+                  i == PACING_SET_A ? "Set A" : "Set B", (unsigned)stats.sweeps,
+                  stats.sweeps ? (unsigned long)(stats.sweepUs / stats.sweeps / 1000) : 0UL,
+                  stats.gaps ? (unsigned long)(stats.gapUs / stats.gaps) : 0UL,
+                  (unsigned)stats.minGapUs, (unsigned)stats.maxGapUs);
+  }
+}
+
+/**
+ * @brief Prints the duration of a sweep that just finished in A/B mode
+ */
+void printAbSweep(const IRSweepStep& step) {
+  consolePrintf("A/B sweep %s: %u ms\n", step.finishedSet == PACING_SET_A ? "A" : "B",
+                (unsigned)(step.sweepUs / 1000));
+}
+
+/**
+ * @brief Prints the lifetime counters
+ */
+void printUsageStats(const UsageTracker& usage) {
+  static const char* const STATE_NAMES[NUM_DEVICE_STATES] = {"idle", "checking", "short", "long"};
+  const UsageStats& stats = usage.stats;
+  uint32_t presses = stats.shortPresses + stats.longPresses;
+
+  consolePrintf("\n=== LIFETIME USAGE ===\n");
+  consolePrintf("Boots: %u, powered time: %lu s\n", (unsigned)stats.bootCount,
+                (unsigned long)(stats.uptimeMs / 1000));
+
+  consolePrintf("Presses: %u short, %u long, per powered day: ",
+                (unsigned)stats.shortPresses, (unsigned)stats.longPresses);
+  if (stats.uptimeMs > 0) {
+    // One decimal without going through float formatting
+    uint64_t perDayX10 = (uint64_t)presses * 864000000ULL / stats.uptimeMs;
+    consolePrintf("%lu.%lu\n", (unsigned long)(perDayX10 / 10), (unsigned long)(perDayX10 % 10));
+  } else {
+    consolePrintf("-\n");
+  }
+
+  consolePrintf("Time in state (s):");
+  for (int i = 0; i < NUM_DEVICE_STATES; i++) {
+    consolePrintf(" %s=%lu", STATE_NAMES[i], (unsigned long)(stats.stateTimeMs[i] / 1000));
+  }
+  consolePrintf("\n");
+
+  consolePrintf("OTA: %u attempts, %u failures\n", (unsigned)stats.otaAttempts,
+                (unsigned)stats.otaFailures);
+
+  consolePrintf("Frames sent per code:\n");
+  for (int i = 0; i < numCommands; i++) {
+    const IRCommand& cmd = irCommands[i];
+    consolePrintf("  %2d %-7s 0x%llX: %u\n", i, irProtocolName(cmd.protocol),
+                  (unsigned long long)cmd.code, (unsigned)stats.framesPerCode[i]);
+  }
+
+  consolePrintf("NVS flushes since boot: %u%s\n", (unsigned)usage.flushCount,
+                usage.dirty ? " (changes pending)" : "");
+  consolePrintf("======================\n\n");
+}
+
+/**
+ * @brief Prints the battery readings and the IR drive chosen from them
+ */
+void printSupplyStatus(const SupplyMonitor& monitor) {
+  if (!monitor.enabled) {
+    consolePrintf("Supply: not monitored (build with -D BATTERY_SENSE_PIN), full IR drive\n");
+    return;
+  }
+  const SupplyDrive& drive = supplyDrive(monitor);
+  consolePrintf("Supply: %u mV at rest, %u mV under IR load (sag %ld mV)\n", (unsigned)monitor.restMv,
+                (unsigned)monitor.loadMv, (long)supplySagMv(monitor));
+  consolePrintf("Loaded: smoothed %u mV, min %u mV, margin %ld mV over %u mV\n",
+                (unsigned)monitor.filteredMv, (unsigned)monitor.minMv, (long)supplyMarginMv(monitor),
+                (unsigned)SUPPLY_CRITICAL_MV);
+  consolePrintf("IR drive level %u/%d (peak %u): +%u ms gap, %u%% duty\n", (unsigned)monitor.level,
+                NUM_SUPPLY_LEVELS - 1, (unsigned)monitor.peakLevel, (unsigned)drive.extraGapMs,
+                (unsigned)drive.dutyPercent);
+  consolePrintf("Samples: %lu, throttles: %lu, releases: %lu\n", (unsigned long)monitor.samples,
+                (unsigned long)monitor.throttles, (unsigned long)monitor.releases);
+}
+
+/**
+ * @brief Prints a drive level change
+ */
+void printSupplyDecision(const SupplyMonitor& monitor, SupplyDecision decision) {
+  static const char* const DECISION_NAMES[] = {"hold", "sag", "deep sag", "recovered"};
+  const SupplyDrive& drive = supplyDrive(monitor);
+  consolePrintf("Supply %s: %u mV under load (margin %ld mV) - IR drive level %u: +%u ms gap, %u%% duty\n",
+                DECISION_NAMES[decision], (unsigned)monitor.loadMv, (long)supplyMarginMv(monitor),
+                (unsigned)monitor.level, (unsigned)drive.extraGapMs, (unsigned)drive.dutyPercent);
+}
@@ -0,0 +1,44 @@
+/*
+ * Serial command interface shared by the Arduino and ESP-IDF builds (type
+ * "help" in the monitor). Reports go through consolePrintf(), which each
+ * firmware implements on its own console without allocating.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ir_sweep.h"
+#include "supply_monitor.h"
+#include "usage_stats.h"
+
+// Implemented by the firmware: formatted text to the serial console
+void consolePrintf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+// Serial input collected into a static line buffer
+struct ConsoleLine {
+  char text[48];
+  size_t length;
+};
+
+// What commands act on; the callbacks do the NVS writes. The state is shared
+// with the IR frame clock: commands hold lock() only to change or copy it
+// and print from the copy, so a slow console never delays a frame. The NVS
+// callbacks are called with the lock held.
+struct ConsoleContext {
+  IRSweep* sweep;
+  UsageTracker* usage;
+  const SupplyMonitor* supply;
+  bool (*savePacing)();       // Stores sweep->pacingSets, returns false on failure
+  void (*flushUsageStats)();  // Stores usage->stats now
+  void (*lock)();             // irClockLock() in the firmware
+  void (*unlock)();
+};
+
+bool consoleLineFeed(ConsoleLine& line, int c);
+void consoleExecute(char* line, const ConsoleContext& ctx);
+void printPacingSet(const char* label, const IRPacing& pacing);
+void printAbReport(const IRSweep& sweep);
+void printAbSweep(const IRSweepStep& step);
+void printUsageStats(const UsageTracker& usage);
+void printSupplyStatus(const SupplyMonitor& monitor);
+void printSupplyDecision(const SupplyMonitor& monitor, SupplyDecision decision);
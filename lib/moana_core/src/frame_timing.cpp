@@ -0,0 +1,32 @@
+#include "frame_timing.h"
+
+#include <string.h>
+
+/**
+ * @brief Clears the measurements (at every activation)
+ */
+void frameTimingReset(FrameTiming& timing) {
+  memset(&timing, 0, sizeof(timing));
+}
+
+/**
+ * @brief Records the real start-to-start interval of two frames against the scheduled one
+ */
+void frameTimingRecord(FrameTiming& timing, uint32_t intervalUs, uint32_t scheduledUs) {
+  uint32_t errorUs = intervalUs > scheduledUs ? intervalUs - scheduledUs : scheduledUs - intervalUs;
+  timing.intervals++;
+  timing.errorSumUs += errorUs;
+  if (errorUs > timing.errorMaxUs) {
+    timing.errorMaxUs = errorUs;
+  }
+  if (errorUs > FRAME_JITTER_TARGET_US) {
+    timing.overTarget++;
+  }
+}
+
+/**
+ * @brief Average interval error in microseconds (0 before the first interval)
+ */
+uint32_t frameTimingAverageUs(const FrameTiming& timing) {
+  return timing.intervals ? (uint32_t)(timing.errorSumUs / timing.intervals) : 0;
+}
@@ -0,0 +1,25 @@
+/*
+ * How closely IR frames keep their spacing. Each emitter's next frame is
+ * scheduled one burst plus gap after the real start of its previous one
+ * (later if another emitter holds the carrier); the error is how far the
+ * real start-to-start interval of two consecutive frames on an emitter is
+ * from the scheduled one, either way. The first frame of an activation has
+ * no interval. Some receivers reject frames that arrive too close together
+ * or too far apart, so the target is well under what any protocol tolerates.
+ */
+#pragma once
+
+#include <stdint.h>
+
+const uint32_t FRAME_JITTER_TARGET_US = 100;
+
+struct FrameTiming {
+  uint32_t intervals;     // Start-to-start intervals measured
+  uint64_t errorSumUs;
+  uint32_t errorMaxUs;
+  uint32_t overTarget;    // Intervals off by more than FRAME_JITTER_TARGET_US
+};
+
+void frameTimingReset(FrameTiming& timing);
+void frameTimingRecord(FrameTiming& timing, uint32_t intervalUs, uint32_t scheduledUs);
+uint32_t frameTimingAverageUs(const FrameTiming& timing);
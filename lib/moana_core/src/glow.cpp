@@ -0,0 +1,18 @@
+#include "glow.h"
+
+#include <math.h>
+
+/**
+ * @brief Breathing brightness, 0-100, elapsedMs after the glow started
+ */
+uint8_t glowBrightness(uint32_t elapsedMs, uint32_t now) {
+  // Base breathing period starts at 4 seconds, accelerates to 0.5 seconds over 10 seconds
+  float accelerationFactor = fminf(elapsedMs / 10000.0f, 1.0f); // 0 to 1 over 10 seconds
+  float breathingPeriod = 4000.0f - (3500.0f * accelerationFactor); // 4000ms to 500ms
+
+  // Calculate breathing phase (0 to 2π for one complete breath cycle)
+  float phase = (2.0f * 3.14159265f * (now % (uint32_t)breathingPeriod)) / breathingPeriod;
+
+  // Calculate brightness using sine wave for smooth breathing
+  return (uint8_t)((sinf(phase) + 1.0f) * 50.0f); // Maps -1,1 to 0,100
+}
@@ -0,0 +1,11 @@
+/*
+ * "Magical Glow" breathing curve shared by the Arduino build (timer ISR soft
+ * PWM) and the ESP-IDF build (LEDC hardware PWM).
+ */
+#pragma once
+
+#include <stdint.h>
+
+const uint32_t GLOW_UPDATE_MS = 10; // Brightness is recalculated this often
+
+uint8_t glowBrightness(uint32_t elapsedMs, uint32_t now);
@@ -0,0 +1,52 @@
+#include "ir_codes.h"
+
+const IRCommand irCommands[] = {
+  // Samsung
+  {IR_SAMSUNG, 0xE0E040BF, 32},
+  {IR_SAMSUNG, 0xE0E019E6, 32},
+  {IR_SAMSUNG, 0xE0E0E01F, 32}, // Samsung Power Toggle - common alternative
+  // LG (NEC)
+  {IR_NEC, 0x20DF10EF, 32},
+  {IR_NEC, 0x20DF23DC, 32},
+  // Sony
+  {IR_SONY, 0xA90, 12}, // 0xA90 is the standard Sony power code
+  {IR_SONY, 0x10A90, 20}, // 20-bit version
+  // Panasonic (using NEC for compatibility)
+  {IR_NEC, 0x40040100BCBD, 32},
+  // Philips (RC6)
+  {IR_RC6, 0xC, 20}, // 0xC is the standard RC6 power code
+  {IR_RC6, 0x10C, 20},
+  // Sharp
+  {IR_SHARP, 0xB54A, 15}, // Standard Sharp power code
+  {IR_SHARP, 0xAA5A, 15}, // Sharp Power Toggle - common alternative
+  // Toshiba (NEC)
+  {IR_NEC, 0x2FD48B7, 32},
+  {IR_NEC, 0x2FD807F, 32},
+  // Vizio (NEC)
+  {IR_NEC, 0x20DF10EF, 32},
+  {IR_NEC, 0x20DF3EC1, 32},
+  // Hisense (NEC)
+  {IR_NEC, 0x20DF40BF, 32},
+  {IR_NEC, 0x25D8C43B, 32},
+  // TCL TV IR codes from DDRBoxman's gist
+  {IR_NEC, 0x57E318E7, 32}, // TCL Power (main power toggle)
+  {IR_NEC, 0x57E316E9, 32}, // TCL Power On
+  {IR_NEC, 0x57E3E817, 32}  // TCL Power (alternate)
+};
+
+static_assert(sizeof(irCommands) / sizeof(irCommands[0]) == numCommands,
+              "numCommands must match the irCommands table");
+
+/**
+ * @brief Short protocol name for diagnostics
+ */
+const char* irProtocolName(IRProtocol protocol) {
+  switch (protocol) {
+    case IR_SAMSUNG: return "SAMSUNG";
+    case IR_NEC:     return "NEC";
+    case IR_SONY:    return "SONY";
+    case IR_RC6:     return "RC6";
+    case IR_SHARP:   return "SHARP";
+    default:         return "OTHER";
+  }
+}
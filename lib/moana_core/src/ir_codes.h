@@ -0,0 +1,34 @@
+/*
+ * IR code table shared by the Arduino and ESP-IDF builds.
+ *
+ * Pure data, no framework headers: the protocols are our own enum so the
+ * table does not pull in IRremoteESP8266.
+ */
+#pragma once
+
+#include <stdint.h>
+
+// IR protocols the waveform encoder knows
+enum IRProtocol : uint8_t {
+  IR_NEC,
+  IR_SAMSUNG,
+  IR_SONY,
+  IR_RC6,
+  IR_SHARP
+};
+
+// Struct to hold all information for a single IR command
+struct IRCommand {
+  IRProtocol protocol;
+  uint64_t code;
+  uint16_t bits; // Used for protocols like Sony that have variable bit lengths
+};
+
+// Entries in irCommands[]; a constant so per-code arrays can be sized with
+// it (checked against the table in ir_codes.cpp)
+const int numCommands = 21;
+
+// The master list of all IR commands to be sent
+extern const IRCommand irCommands[];
+
+const char* irProtocolName(IRProtocol protocol);
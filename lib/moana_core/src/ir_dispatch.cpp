@@ -0,0 +1,24 @@
+#include "ir_dispatch.h"
+
+/**
+ * @brief Earliest start at or after readyAtUs that keeps the carrier free of other emitters
+ */
+uint32_t irDispatchStart(const IRAirSlot* slots, int count, int emitter, uint32_t carrierHz, uint32_t readyAtUs) {
+  uint32_t startUs = readyAtUs;
+  for (int e = 0; e < count; e++) {
+    // Wrap-safe: slots of past activations compare as long over
+    if (e != emitter && slots[e].carrierHz == carrierHz && (int32_t)(slots[e].untilUs - startUs) > 0) {
+      startUs = slots[e].untilUs;
+    }
+  }
+  return startUs;
+}
+
+/**
+ * @brief True if the slot's emitter cannot have its LED on between fromUs and toUs
+ */
+bool irAirSlotQuiet(const IRAirSlot& slot, uint32_t fromUs, uint32_t toUs) {
+  bool burstOverlaps = (int32_t)(slot.burstEndUs - fromUs) > 0 && (int32_t)(slot.startUs - toUs) < 0;
+  bool nextFrameOverlaps = (int32_t)(slot.untilUs - toUs) < 0;
+  return !burstOverlaps && !nextFrameOverlaps;
+}
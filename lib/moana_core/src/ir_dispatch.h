@@ -0,0 +1,30 @@
+/*
+ * Carrier-aware dispatch of sweep codes across the IR emitters, shared by
+ * the Arduino and ESP-IDF builds. All emitters face the same receivers, so
+ * two frames on the same carrier must not be on air together: the receiver
+ * would see one garbled frame. A free emitter whose next code shares the
+ * carrier of a frame still on air on another emitter waits until that frame
+ * and its pacing gap are over; frames on different carriers overlap.
+ *
+ * Every emitter's slot is taken when its burst is loaded and updated when
+ * it starts, so at any decision the other slots describe frames that are
+ * loaded or on air.
+ *
+ * The slots also tell when another emitter may have its LED on, which
+ * battery samples have to avoid (irAirSlotQuiet): during its burst, and
+ * again from untilUs, since its next frame cannot start before that.
+ */
+#pragma once
+
+#include <stdint.h>
+
+// What one emitter has on air
+struct IRAirSlot {
+  uint32_t carrierHz;   // Carrier of its last burst
+  uint32_t untilUs;     // End of that burst plus the pacing gap
+  uint32_t startUs;     // Start of that burst
+  uint32_t burstEndUs;  // End of that burst, protocol padding included
+};
+
+uint32_t irDispatchStart(const IRAirSlot* slots, int count, int emitter, uint32_t carrierHz, uint32_t readyAtUs);
+bool irAirSlotQuiet(const IRAirSlot& slot, uint32_t fromUs, uint32_t toUs);
@@ -0,0 +1,242 @@
+#include "ir_encoder.h"
+
+/**
+ * @brief Clears a waveform and selects its carrier
+ */
+void irWaveformReset(IRWaveform& wave, uint32_t carrierHz) {
+  wave.carrierHz = carrierHz;
+  wave.totalUs = 0;
+  wave.count = 0;
+  wave.overflow = false;
+}
+
+/**
+ * @brief Appends carrier-on time, merging with a preceding mark
+ */
+void irMark(IRWaveform& wave, uint32_t us) {
+  if (us == 0) {
+    return;
+  }
+  wave.totalUs += us;
+  if (wave.count % 2 == 1) {
+    wave.durations[wave.count - 1] += us;
+  } else if (wave.count < IR_MAX_DURATIONS) {
+    wave.durations[wave.count++] = us;
+  } else {
+    wave.overflow = true;
+  }
+}
+
+/**
+ * @brief Appends carrier-off time, merging with a preceding space
+ */
+void irSpace(IRWaveform& wave, uint32_t us) {
+  if (us == 0 || wave.count == 0) {
+    return; // Leading silence is just idle time
+  }
+  wave.totalUs += us;
+  if (wave.count % 2 == 0) {
+    wave.durations[wave.count - 1] += us;
+  } else if (wave.count < IR_MAX_DURATIONS) {
+    wave.durations[wave.count++] = us;
+  } else {
+    wave.overflow = true;
+  }
+}
+
+/**
+ * @brief Appends data bits, most significant first
+ */
+void irBits(IRWaveform& wave, uint64_t data, uint16_t nbits,
+            uint32_t oneMark, uint32_t oneSpace, uint32_t zeroMark, uint32_t zeroSpace) {
+  for (uint64_t mask = 1ULL << (nbits - 1); mask; mask >>= 1) {
+    if (data & mask) {
+      irMark(wave, oneMark);
+      irSpace(wave, oneSpace);
+    } else {
+      irMark(wave, zeroMark);
+      irSpace(wave, zeroSpace);
+    }
+  }
+}
+
+/**
+ * @brief Ends a frame: at least minGapUs of silence, padded to minLengthUs from frameStartUs
+ */
+void irFrameGap(IRWaveform& wave, uint32_t frameStartUs, uint32_t minGapUs, uint32_t minLengthUs) {
+  uint32_t elapsed = wave.totalUs - frameStartUs;
+  uint32_t gap = (elapsed + minGapUs < minLengthUs) ? minLengthUs - elapsed : minGapUs;
+  irSpace(wave, gap);
+}
+
+/**
+ * @brief Encodes a full frame followed by `repeats` repeats in the protocol's repeat form
+ * @return false if the burst did not fit the waveform buffer and was truncated
+ */
+bool irEncodeBurst(IRWaveform& wave, const IRCommand& cmd, uint16_t repeats, bool toggle) {
+  switch (cmd.protocol) {
+    case IR_SAMSUNG:
+      irWaveformReset(wave, irCarrierHz(cmd.protocol));
+      for (uint16_t r = 0; r <= repeats; r++) {
+        uint32_t frameStart = wave.totalUs;
+        irMark(wave, SAMSUNG_HDR_MARK);
+        irSpace(wave, SAMSUNG_HDR_SPACE);
+        irBits(wave, cmd.code, cmd.bits, SAMSUNG_BIT_MARK, SAMSUNG_ONE_SPACE, SAMSUNG_BIT_MARK, SAMSUNG_ZERO_SPACE);
+        irMark(wave, SAMSUNG_BIT_MARK);
+        irFrameGap(wave, frameStart, SAMSUNG_MIN_GAP_US, SAMSUNG_MIN_MESSAGE_US);
+      }
+      break;
+
+    case IR_SONY:
+      irWaveformReset(wave, irCarrierHz(cmd.protocol));
+      for (uint16_t r = 0; r <= repeats; r++) {
+        uint32_t frameStart = wave.totalUs;
+        irMark(wave, SONY_HDR_MARK);
+        irSpace(wave, SONY_SPACE);
+        irBits(wave, cmd.code, cmd.bits, SONY_ONE_MARK, SONY_SPACE, SONY_ZERO_MARK, SONY_SPACE);
+        irFrameGap(wave, frameStart, SONY_MIN_GAP_US, SONY_RPT_LENGTH_US);
+      }
+      break;
+
+    case IR_RC6: {
+      // Mode 0: leader, start bit, then Manchester bits (1 = mark first);
+      // the fourth bit is the double-width toggle bit
+      uint64_t data = toggle ? cmd.code ^ (1ULL << (cmd.bits - 4)) : cmd.code;
+      irWaveformReset(wave, irCarrierHz(cmd.protocol));
+      for (uint16_t r = 0; r <= repeats; r++) {
+        irMark(wave, RC6_HDR_MARK);
+        irSpace(wave, RC6_HDR_SPACE);
+        irMark(wave, RC6_TICK);
+        irSpace(wave, RC6_TICK);
+        uint16_t bit = 1;
+        for (uint64_t mask = 1ULL << (cmd.bits - 1); mask; mask >>= 1, bit++) {
+          uint32_t bitTime = (bit == 4) ? 2 * RC6_TICK : RC6_TICK;
+          if (data & mask) {
+            irMark(wave, bitTime);
+            irSpace(wave, bitTime);
+          } else {
+            irSpace(wave, bitTime);
+            irMark(wave, bitTime);
+          }
+        }
+        irSpace(wave, RC6_RPT_LENGTH_US);
+      }
+      break;
+    }
+
+    case IR_SHARP: {
+      // Each press is the frame, then the frame with command bits inverted
+      uint64_t data = cmd.code;
+      irWaveformReset(wave, irCarrierHz(cmd.protocol));
+      for (uint16_t r = 0; r <= repeats; r++) {
+        for (int half = 0; half < 2; half++) {
+          irBits(wave, data, cmd.bits, SHARP_BIT_MARK, SHARP_ONE_SPACE, SHARP_BIT_MARK, SHARP_ZERO_SPACE);
+          irMark(wave, SHARP_BIT_MARK);
+          irSpace(wave, SHARP_GAP_US);
+          data ^= SHARP_INVERT_MASK;
+        }
+      }
+      break;
+    }
+
+    case IR_NEC:
+    default: {
+      // Unknown protocols fall back to NEC
+      irWaveformReset(wave, irCarrierHz(cmd.protocol));
+      uint32_t frameStart = wave.totalUs;
+      irMark(wave, NEC_HDR_MARK);
+      irSpace(wave, NEC_HDR_SPACE);
+      irBits(wave, cmd.code, cmd.bits, NEC_BIT_MARK, NEC_ONE_SPACE, NEC_BIT_MARK, NEC_ZERO_SPACE);
+      irMark(wave, NEC_BIT_MARK);
+      irFrameGap(wave, frameStart, NEC_MIN_GAP_US, NEC_MIN_COMMAND_US);
+      for (uint16_t r = 0; r < repeats; r++) {
+        // NEC repeat code: header mark, short space, stop mark
+        frameStart = wave.totalUs;
+        irMark(wave, NEC_HDR_MARK);
+        irSpace(wave, NEC_RPT_SPACE);
+        irMark(wave, NEC_BIT_MARK);
+        irFrameGap(wave, frameStart, NEC_MIN_GAP_US, NEC_MIN_COMMAND_US);
+      }
+      break;
+    }
+  }
+
+  return !wave.overflow;
+}
+
+/**
+ * @brief Signal time of one full frame, first mark to last mark (gaps excluded)
+ *
+ * This is what the LED draws current for, not how long the frame occupies
+ * the emitter: the padding after each frame is in IRWaveform::totalUs.
+ */
+uint32_t irFrameAirtimeUs(const IRCommand& cmd) {
+  uint64_t data = cmd.code;
+  if (cmd.bits < 64) {
+    data &= (1ULL << cmd.bits) - 1;
+  }
+  uint32_t ones = __builtin_popcountll(data);
+  uint32_t zeros = cmd.bits - ones;
+
+  switch (cmd.protocol) {
+    case IR_SAMSUNG:
+      return SAMSUNG_HDR_MARK + SAMSUNG_HDR_SPACE + (cmd.bits + 1) * SAMSUNG_BIT_MARK +
+             ones * SAMSUNG_ONE_SPACE + zeros * SAMSUNG_ZERO_SPACE;
+    case IR_SONY:
+      return SONY_HDR_MARK + cmd.bits * SONY_SPACE + ones * SONY_ONE_MARK + zeros * SONY_ZERO_MARK;
+    case IR_RC6:
+      // Leader, start bit, then one Manchester cell per bit; the toggle bit is double width
+      return RC6_HDR_MARK + RC6_HDR_SPACE + 2 * RC6_TICK + (cmd.bits + 1) * 2 * RC6_TICK;
+    case IR_SHARP: {
+      // Sent twice, the second time with the command bits inverted
+      uint32_t invOnes = __builtin_popcountll(data ^ SHARP_INVERT_MASK);
+      uint32_t bitCells = 2 * (cmd.bits + 1) * SHARP_BIT_MARK;
+      return bitCells + (ones + invOnes) * SHARP_ONE_SPACE +
+             (2 * cmd.bits - ones - invOnes) * SHARP_ZERO_SPACE;
+    }
+    case IR_NEC:
+    default:
+      return NEC_HDR_MARK + NEC_HDR_SPACE + (cmd.bits + 1) * NEC_BIT_MARK +
+             ones * NEC_ONE_SPACE + zeros * NEC_ZERO_SPACE;
+  }
+}
+
+/**
+ * @brief Signal time of one repeat in a held-button burst
+ */
+uint32_t irRepeatAirtimeUs(const IRCommand& cmd) {
+  switch (cmd.protocol) {
+    case IR_SAMSUNG:
+    case IR_SONY:
+    case IR_RC6:
+    case IR_SHARP:
+      return irFrameAirtimeUs(cmd); // No compact form: the full frame is repeated
+    case IR_NEC:
+    default:
+      return NEC_HDR_MARK + NEC_RPT_SPACE + NEC_BIT_MARK;
+  }
+}
+
+/**
+ * @brief IR carrier a protocol is modulated on
+ */
+uint32_t irCarrierHz(IRProtocol protocol) {
+  switch (protocol) {
+    case IR_SONY:
+      return SONY_CARRIER_HZ;
+    case IR_RC6:
+      return RC6_CARRIER_HZ;
+    case IR_NEC:
+    case IR_SAMSUNG:
+    case IR_SHARP:
+    default:
+      return NEC_CARRIER_HZ;
+  }
+}
+
+/**
+ * @brief True if the protocol's repeat form is shorter on air than its full frame
+ */
+bool irHasCompactRepeat(IRProtocol protocol) {
+  return protocol == IR_NEC;
+}
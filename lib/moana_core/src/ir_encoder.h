@@ -0,0 +1,86 @@
+/*
+ * IR waveform encoder and airtime model shared by the Arduino and ESP-IDF
+ * builds. A burst (full frame plus its repeats) is encoded into alternating
+ * mark and space durations; packing them for the RMT peripheral is left to
+ * the emitter driver.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "ir_codes.h"
+
+// A burst is the full frame followed by `repeats` copies of the protocol's
+// own repeat form. For NEC that is the 11.25 ms repeat code instead of the
+// 67.5 ms frame: far less LED on-time, but repeats keep the protocol's
+// 108 ms start-to-start spacing, so a burst never gets shorter on the clock
+// than its first frame. RC6 repeats the frame with an unchanged toggle bit;
+// the toggle flips once per sweep so each new burst reads as a fresh press.
+// Samsung, Sony and Sharp have no shorter form and repeat the full frame.
+//
+// Held-button repeats (longPressRepeats, see IRPacing) are therefore only
+// sent for protocols with a compact repeat form (irHasCompactRepeat); the
+// others get a single press per target, which is the fastest sweep.
+const uint16_t SONY_MIN_REPEATS = 2; // SIRC receivers want 3 frames per press
+
+// Mark/space timings in microseconds, matching IRremoteESP8266
+const uint32_t NEC_HDR_MARK      = 8960;
+const uint32_t NEC_HDR_SPACE     = 4480;
+const uint32_t NEC_RPT_SPACE     = 2240;
+const uint32_t NEC_BIT_MARK      = 560;
+const uint32_t NEC_ONE_SPACE     = 1680;
+const uint32_t NEC_ZERO_SPACE    = 560;
+const uint32_t SAMSUNG_HDR_MARK  = 4480;
+const uint32_t SAMSUNG_HDR_SPACE = 4480;
+const uint32_t SAMSUNG_BIT_MARK  = 560;
+const uint32_t SAMSUNG_ONE_SPACE = 1680;
+const uint32_t SAMSUNG_ZERO_SPACE = 560;
+const uint32_t SONY_HDR_MARK     = 2400;
+const uint32_t SONY_SPACE        = 600;
+const uint32_t SONY_ONE_MARK     = 1200;
+const uint32_t SONY_ZERO_MARK    = 600;
+const uint32_t RC6_HDR_MARK      = 2666;
+const uint32_t RC6_HDR_SPACE     = 889;
+const uint32_t RC6_TICK          = 444;
+const uint32_t SHARP_BIT_MARK    = 260;
+const uint32_t SHARP_ONE_SPACE   = 1820;
+const uint32_t SHARP_ZERO_SPACE  = 780;
+const uint64_t SHARP_INVERT_MASK = 0x3FF; // Second Sharp frame inverts command, expansion and check bits
+
+// Frame spacing in microseconds: frames are padded to a minimum length
+// (start to start) with at least the minimum gap after the last mark
+const uint32_t NEC_MIN_COMMAND_US      = 107520;
+const uint32_t NEC_MIN_GAP_US          = 21840;
+const uint32_t SAMSUNG_MIN_MESSAGE_US  = 108080;
+const uint32_t SAMSUNG_MIN_GAP_US      = 26880;
+const uint32_t SONY_RPT_LENGTH_US      = 45000;
+const uint32_t SONY_MIN_GAP_US         = 10000;
+const uint32_t RC6_RPT_LENGTH_US       = 83000;
+const uint32_t SHARP_GAP_US            = 43602;
+
+// Carrier frequencies
+const uint32_t NEC_CARRIER_HZ   = 38000;
+const uint32_t SONY_CARRIER_HZ  = 40000;
+const uint32_t RC6_CARRIER_HZ   = 36000;
+const uint32_t IR_DUTY_PERCENT  = 33;
+
+const int IR_MAX_DURATIONS = 768;  // Worst case: Sharp with 10 repeats
+
+struct IRWaveform {
+  uint32_t carrierHz;
+  uint32_t totalUs;       // Burst length including trailing gaps
+  uint16_t count;         // Durations used; even entries are marks, odd are spaces
+  bool overflow;
+  uint32_t durations[IR_MAX_DURATIONS];
+};
+
+void irWaveformReset(IRWaveform& wave, uint32_t carrierHz);
+void irMark(IRWaveform& wave, uint32_t us);
+void irSpace(IRWaveform& wave, uint32_t us);
+void irBits(IRWaveform& wave, uint64_t data, uint16_t nbits,
+            uint32_t oneMark, uint32_t oneSpace, uint32_t zeroMark, uint32_t zeroSpace);
+void irFrameGap(IRWaveform& wave, uint32_t frameStartUs, uint32_t minGapUs, uint32_t minLengthUs);
+bool irEncodeBurst(IRWaveform& wave, const IRCommand& cmd, uint16_t repeats, bool toggle);
+uint32_t irFrameAirtimeUs(const IRCommand& cmd);
+uint32_t irRepeatAirtimeUs(const IRCommand& cmd);
+bool irHasCompactRepeat(IRProtocol protocol);
+uint32_t irCarrierHz(IRProtocol protocol);
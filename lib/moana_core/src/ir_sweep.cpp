@@ -0,0 +1,212 @@
+#include "ir_sweep.h"
+#include "ir_encoder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const char* const SWEEP_ORDER_NAMES[SWEEP_ORDER_COUNT] = {"forward", "reverse", "interleaved"};
+
+/**
+ * @brief Resets the scheduler to default pacing, set A, top of the sweep
+ */
+void irSweepInit(IRSweep& sweep) {
+  memset(&sweep, 0, sizeof(sweep));
+  sweep.pacingSets[PACING_SET_A] = DEFAULT_PACING;
+  sweep.pacingSets[PACING_SET_B] = DEFAULT_PACING;
+  sweep.activePacingSet = PACING_SET_A;
+  irSweepApplyOrder(sweep);
+}
+
+/**
+ * @brief Pacing set currently driving the sweep
+ */
+const IRPacing& irSweepPacing(const IRSweep& sweep) {
+  return sweep.pacingSets[sweep.activePacingSet];
+}
+
+/**
+ * @brief Rebuilds the visiting order after the active set or its order changed
+ */
+void irSweepApplyOrder(IRSweep& sweep) {
+  buildSweepOrder(irSweepPacing(sweep).sweepOrder, sweep.order);
+}
+
+/**
+ * @brief Starts the cadence measurement of a new activation
+ */
+void irSweepBeginActivation(IRSweep& sweep) {
+  sweep.lastFrameValid = false;
+  sweep.sweepStarted = false;
+}
+
+/**
+ * @brief irCommands index irSweepNext() hands out next
+ */
+int irSweepNextCommand(const IRSweep& sweep) {
+  return sweep.order[sweep.position];
+}
+
+/**
+ * @brief Hands out the next burst and advances the sweep position.
+ *
+ * Also records the frame start for the A/B sweep and cadence measurements.
+ * When the position wraps, the RC6 toggle flips (the next sweep is a new
+ * press for RC6 receivers) and, in A/B mode, the other pacing set takes over.
+ */
+IRSweepStep irSweepNext(IRSweep& sweep, uint32_t nowUs, bool held) {
+  IRSweepStep step = {};
+  PacingStats& stats = sweep.pacingStats[sweep.activePacingSet];
+
+  if (sweep.position == 0) {
+    sweep.sweepStartUs = nowUs;
+    sweep.sweepStarted = true;
+  }
+  if (sweep.lastFrameValid) {
+    uint32_t gapUs = nowUs - sweep.lastFrameStartUs;
+    if (stats.gaps == 0 || gapUs < stats.minGapUs) {
+      stats.minGapUs = gapUs;
+    }
+    if (gapUs > stats.maxGapUs) {
+      stats.maxGapUs = gapUs;
+    }
+    stats.gaps++;
+    stats.gapUs += gapUs;
+  }
+  sweep.lastFrameStartUs = nowUs;
+  sweep.lastFrameValid = true;
+
+  step.command = irSweepNextCommand(sweep);
+  step.repeats = irBurstRepeats(irCommands[step.command], irSweepPacing(sweep), held);
+  step.toggle = sweep.rc6Toggle;
+
+  // Increment and wrap the sweep position to loop through all commands
+  sweep.position = (sweep.position + 1) % numCommands;
+  if (sweep.position != 0) {
+    return step;
+  }
+
+  sweep.rc6Toggle = !sweep.rc6Toggle;
+  step.sweepFinished = true;
+  step.finishedSet = sweep.activePacingSet;
+  if (sweep.sweepStarted) {
+    step.sweepMeasured = true;
+    step.sweepUs = nowUs - sweep.sweepStartUs;
+    stats.sweeps++;
+    stats.sweepUs += step.sweepUs;
+  }
+  sweep.sweepStarted = false;
+
+  if (sweep.abModeEnabled) {
+    sweep.activePacingSet = (sweep.activePacingSet == PACING_SET_A) ? PACING_SET_B : PACING_SET_A;
+    irSweepApplyOrder(sweep);
+  }
+  return step;
+}
+
+/**
+ * @brief Turns A/B alternation on (fresh measurements) or off (back to set A)
+ */
+void irSweepSetAbMode(IRSweep& sweep, bool enabled) {
+  sweep.abModeEnabled = enabled;
+  if (enabled) {
+    irSweepResetStats(sweep);
+  } else {
+    sweep.activePacingSet = PACING_SET_A;
+    irSweepApplyOrder(sweep);
+  }
+}
+
+/**
+ * @brief Clears the A/B measurements
+ */
+void irSweepResetStats(IRSweep& sweep) {
+  memset(sweep.pacingStats, 0, sizeof(sweep.pacingStats));
+  sweep.sweepStarted = false;
+  sweep.lastFrameValid = false;
+}
+
+/**
+ * @brief Checks that a pacing set read from NVS or typed in is usable
+ */
+bool isValidPacing(const IRPacing& pacing) {
+  return pacing.frameGapMs >= 1 && pacing.frameGapMs <= MAX_FRAME_GAP_MS &&
+         pacing.shortPressRepeats <= MAX_PACING_REPEATS &&
+         pacing.longPressRepeats <= MAX_PACING_REPEATS &&
+         pacing.sweepOrder < SWEEP_ORDER_COUNT;
+}
+
+/**
+ * @brief Applies "key value" to a pacing set, returns false if rejected
+ */
+bool setPacingParam(IRPacing& pacing, const char* key, const char* value) {
+  if (!key || !value) {
+    return false;
+  }
+
+  IRPacing updated = pacing;
+  char* end = nullptr;
+  unsigned long number = strtoul(value, &end, 10);
+  bool isNumber = (end != value && *end == '\0');
+
+  // Range-check before narrowing into the struct fields
+  if (strcmp(key, "gap") == 0 && isNumber && number <= MAX_FRAME_GAP_MS) {
+    updated.frameGapMs = number;
+  } else if (strcmp(key, "short") == 0 && isNumber && number <= MAX_PACING_REPEATS) {
+    updated.shortPressRepeats = number;
+  } else if (strcmp(key, "long") == 0 && isNumber && number <= MAX_PACING_REPEATS) {
+    updated.longPressRepeats = number;
+  } else if (strcmp(key, "order") == 0) {
+    updated.sweepOrder = (isNumber && number < SWEEP_ORDER_COUNT) ? (uint8_t)number : (uint8_t)SWEEP_ORDER_COUNT;
+    for (int i = 0; i < SWEEP_ORDER_COUNT; i++) {
+      if (strcmp(value, SWEEP_ORDER_NAMES[i]) == 0) {
+        updated.sweepOrder = i;
+      }
+    }
+  } else {
+    return false;
+  }
+
+  if (!isValidPacing(updated)) {
+    return false;
+  }
+  pacing = updated;
+  return true;
+}
+
+/**
+ * @brief Fills sweepOrder[numCommands] with the irCommands visiting order
+ */
+void buildSweepOrder(uint8_t order, uint8_t* sweepOrder) {
+  int half = (numCommands + 1) / 2;
+  for (int i = 0; i < numCommands; i++) {
+    switch (order) {
+      case SWEEP_REVERSE:
+        sweepOrder[i] = numCommands - 1 - i;
+        break;
+      case SWEEP_INTERLEAVED:
+        sweepOrder[i] = (i % 2 == 0) ? i / 2 : half + i / 2;
+        break;
+      case SWEEP_FORWARD:
+      default:
+        sweepOrder[i] = i;
+        break;
+    }
+  }
+}
+
+/**
+ * @brief Number of repeats to follow a command's full frame with
+ *
+ * Held-button repeats only go to protocols with a compact repeat form: for
+ * the others they would just resend the full frame (see ir_encoder.h).
+ */
+uint16_t irBurstRepeats(const IRCommand& cmd, const IRPacing& pacing, bool held) {
+  uint16_t repeats = held ? pacing.longPressRepeats : pacing.shortPressRepeats;
+  if (held && !irHasCompactRepeat(cmd.protocol)) {
+    repeats = 0;
+  }
+  if (cmd.protocol == IR_SONY && repeats < SONY_MIN_REPEATS) {
+    repeats = SONY_MIN_REPEATS;
+  }
+  return repeats;
+}
@@ -0,0 +1,86 @@
+/*
+ * IR sweep scheduler shared by the Arduino and ESP-IDF builds: pacing sets,
+ * visiting order, the sweep position and the A/B measurements. It decides
+ * what goes out next; the firmware owns the emitters and the clock.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "ir_codes.h"
+
+// Sweep pacing can be tuned per TV brand without reflashing: the values are
+// stored in NVS, loaded once at boot and changed over the serial command
+// interface (type "help" in the monitor).
+enum SweepOrder : uint8_t {
+  SWEEP_FORWARD,      // Table order
+  SWEEP_REVERSE,      // Table order backwards
+  SWEEP_INTERLEAVED,  // Alternates first and second half so brands are spread out
+  SWEEP_ORDER_COUNT
+};
+
+struct IRPacing {
+  uint16_t frameGapMs;        // Pause after each frame while active
+  uint8_t shortPressRepeats;  // Repeats after each full frame in short press
+  uint8_t longPressRepeats;   // NEC repeat codes per held-button burst in long press
+  uint8_t sweepOrder;         // SweepOrder
+};
+
+const IRPacing DEFAULT_PACING = {10, 0, 0, SWEEP_FORWARD}; // One press per target: fastest sweep
+const uint16_t MAX_FRAME_GAP_MS = 1000;
+const uint8_t MAX_PACING_REPEATS = 10;
+
+extern const char* const SWEEP_ORDER_NAMES[SWEEP_ORDER_COUNT];
+
+// Set A drives normal operation. A/B mode alternates A and B every sweep and
+// measures both, so two candidates can be compared on real hardware.
+const int PACING_SET_A = 0;
+const int PACING_SET_B = 1;
+
+// Per-set A/B measurements
+struct PacingStats {
+  uint32_t sweeps;
+  uint64_t sweepUs;      // Sum of complete sweep durations
+  uint32_t gaps;
+  uint64_t gapUs;        // Sum of frame start -> frame start intervals
+  uint32_t minGapUs;
+  uint32_t maxGapUs;
+};
+
+struct IRSweep {
+  IRPacing pacingSets[2];
+  int activePacingSet;
+  bool abModeEnabled;
+  uint8_t order[numCommands];  // Sweep position -> irCommands index for the active order
+  int position;                // Next sweep position
+  bool rc6Toggle;
+  PacingStats pacingStats[2];
+  uint32_t sweepStartUs;
+  bool sweepStarted;           // Current sweep began at position 0 this activation
+  uint32_t lastFrameStartUs;
+  bool lastFrameValid;         // False until the first frame of an activation
+};
+
+// One burst handed out by irSweepNext()
+struct IRSweepStep {
+  int command;          // irCommands index
+  uint16_t repeats;     // Repeats after the full frame
+  bool toggle;          // RC6 toggle bit
+  bool sweepFinished;   // This burst closed a sweep
+  bool sweepMeasured;   // ...and that sweep started at position 0 this activation
+  int finishedSet;      // Pacing set that ran the finished sweep
+  uint32_t sweepUs;     // Its duration, if measured
+};
+
+void irSweepInit(IRSweep& sweep);
+const IRPacing& irSweepPacing(const IRSweep& sweep);
+void irSweepApplyOrder(IRSweep& sweep);
+void irSweepBeginActivation(IRSweep& sweep);
+int irSweepNextCommand(const IRSweep& sweep);
+IRSweepStep irSweepNext(IRSweep& sweep, uint32_t nowUs, bool held);
+void irSweepSetAbMode(IRSweep& sweep, bool enabled);
+void irSweepResetStats(IRSweep& sweep);
+
+bool isValidPacing(const IRPacing& pacing);
+bool setPacingParam(IRPacing& pacing, const char* key, const char* value);
+void buildSweepOrder(uint8_t order, uint8_t* sweepOrder);
+uint16_t irBurstRepeats(const IRCommand& cmd, const IRPacing& pacing, bool held);
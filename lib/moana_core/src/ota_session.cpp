@@ -0,0 +1,88 @@
+#include "ota_session.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Compares a request's password header, in time that does not depend on where it differs
+ */
+bool otaPasswordMatches(const char* given, const char* expected) {
+  size_t length = strlen(expected);
+  if (strlen(given) != length) {
+    return false;
+  }
+  uint8_t diff = 0;
+  for (size_t i = 0; i < length; i++) {
+    diff |= (uint8_t)(given[i] ^ expected[i]);
+  }
+  return diff == 0;
+}
+
+/**
+ * @brief Parses "bytes <first>-<last>/<total>" into a range, false if malformed
+ */
+bool otaParseContentRange(const char* header, OtaRange& range) {
+  if (strncmp(header, "bytes ", 6) != 0) {
+    return false;
+  }
+  char* end = nullptr;
+  unsigned long first = strtoul(header + 6, &end, 10);
+  if (*end != '-') {
+    return false;
+  }
+  unsigned long last = strtoul(end + 1, &end, 10);
+  if (*end != '/') {
+    return false;
+  }
+  unsigned long total = strtoul(end + 1, &end, 10);
+  if (*end != '\0' || last < first || last >= total) {
+    return false;
+  }
+  range.start = first;
+  range.end = last + 1;
+  range.total = total;
+  return true;
+}
+
+/**
+ * @brief Parses 64 hex digits into a SHA-256, false if malformed
+ */
+bool otaParseSha256(const char* hex, uint8_t* sha256) {
+  if (strlen(hex) != OTA_SHA256_BYTES * 2) {
+    return false;
+  }
+  for (size_t i = 0; i < OTA_SHA256_BYTES; i++) {
+    char byte[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+    char* end = nullptr;
+    sha256[i] = (uint8_t)strtoul(byte, &end, 16);
+    if (*end != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief True if the session in progress is writing this image
+ */
+bool otaSessionMatches(const OtaSession& session, uint32_t size, const uint8_t* sha256) {
+  return session.active && session.size == size && memcmp(session.sha256, sha256, OTA_SHA256_BYTES) == 0;
+}
+
+/**
+ * @brief Where a client should continue sending this image (0 if it is not in progress)
+ */
+uint32_t otaSessionResumeOffset(const OtaSession& session, uint32_t size, const uint8_t* sha256) {
+  return otaSessionMatches(session, size, sha256) ? session.offset : 0;
+}
+
+/**
+ * @brief Decides whether a range starts a new image, continues the current one or must be resent
+ */
+OtaChunkDecision otaSessionCheck(const OtaSession& session, const OtaRange& range, const uint8_t* sha256) {
+  if (otaSessionMatches(session, range.total, sha256)) {
+    return range.start == session.offset ? OTA_CHUNK_CONTINUE : OTA_CHUNK_OUT_OF_ORDER;
+  }
+  // A different image replaces the one in progress, but only from its first byte
+  return range.start == 0 ? OTA_CHUNK_NEW_IMAGE : OTA_CHUNK_OUT_OF_ORDER;
+}
@@ -0,0 +1,42 @@
+/*
+ * Bookkeeping for resumable firmware uploads. An image is identified by its
+ * size and SHA-256 and sent in byte ranges (Content-Range: bytes a-b/total),
+ * one HTTP request per range. The write offset survives dropped connections,
+ * so a client asks where to continue and sends only the rest. The firmware
+ * does the flash writes and hashing (ota_http.h); this is the part that
+ * decides what a request means. Every request carries the OTA password,
+ * as espota's --auth did.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+const size_t OTA_SHA256_BYTES = 32;
+
+// One range of the image; end is exclusive
+struct OtaRange {
+  uint32_t start;
+  uint32_t end;
+  uint32_t total;
+};
+
+struct OtaSession {
+  bool active;                        // An image is partly written
+  uint32_t size;                      // Image size
+  uint32_t offset;                    // Bytes written and hashed so far
+  uint8_t sha256[OTA_SHA256_BYTES];   // Expected hash of the whole image
+};
+
+enum OtaChunkDecision {
+  OTA_CHUNK_NEW_IMAGE,     // Range starts at 0 of an image that is not in progress
+  OTA_CHUNK_CONTINUE,      // Range continues the image in progress
+  OTA_CHUNK_OUT_OF_ORDER   // Client must resume at otaSessionResumeOffset()
+};
+
+bool otaPasswordMatches(const char* given, const char* expected);
+bool otaParseContentRange(const char* header, OtaRange& range);
+bool otaParseSha256(const char* hex, uint8_t* sha256);
+bool otaSessionMatches(const OtaSession& session, uint32_t size, const uint8_t* sha256);
+uint32_t otaSessionResumeOffset(const OtaSession& session, uint32_t size, const uint8_t* sha256);
+OtaChunkDecision otaSessionCheck(const OtaSession& session, const OtaRange& range, const uint8_t* sha256);
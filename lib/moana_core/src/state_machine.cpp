@@ -0,0 +1,64 @@
+#include "state_machine.h"
+
+/**
+ * @brief Handles a debounced button press; activates the device when idle
+ */
+StateEvent stateMachinePress(StateMachine& machine, uint32_t now) {
+  machine.lastButtonPressTime = now;
+  if (machine.state != STATE_IDLE) {
+    return STATE_EVENT_NONE;
+  }
+  machine.state = STATE_CHECKING_PRESS;
+  machine.operationStartTime = now; // Start timing immediately
+  return STATE_EVENT_ACTIVATED;
+}
+
+/**
+ * @brief Advances the state machine based on button level and timing
+ */
+StateEvent stateMachineUpdate(StateMachine& machine, bool buttonDown, uint32_t now) {
+  switch (machine.state) {
+    case STATE_IDLE:
+      // Do nothing, wait for button press
+      break;
+
+    case STATE_CHECKING_PRESS:
+      if (buttonDown) {
+        // Button still pressed, check if it's been long enough for long press
+        if (now - machine.lastButtonPressTime >= LONG_PRESS_MS) {
+          // Keep the same operationStartTime so timing continues from button press
+          machine.state = STATE_RUNNING_LONG;
+          return STATE_EVENT_LONG_PRESS;
+        }
+      } else {
+        // Button released before long press threshold
+        machine.state = STATE_RUNNING_SHORT;
+        return STATE_EVENT_SHORT_PRESS;
+      }
+      break;
+
+    case STATE_RUNNING_SHORT:
+      // Check if 10 seconds have elapsed from the initial button press
+      if (now - machine.operationStartTime >= SHORT_PRESS_DURATION_MS) {
+        machine.state = STATE_IDLE;
+        return STATE_EVENT_FINISHED;
+      }
+      break;
+
+    case STATE_RUNNING_LONG:
+      if (!buttonDown) {
+        machine.state = STATE_IDLE;
+        return STATE_EVENT_FINISHED;
+      }
+      break;
+  }
+  return STATE_EVENT_NONE;
+}
+
+/**
+ * @brief True while glow, IR and BLE should run
+ */
+bool stateMachineActive(const StateMachine& machine) {
+  return machine.state == STATE_CHECKING_PRESS || machine.state == STATE_RUNNING_SHORT ||
+         machine.state == STATE_RUNNING_LONG;
+}
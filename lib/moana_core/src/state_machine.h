@@ -0,0 +1,41 @@
+/*
+ * Play state machine shared by the Arduino and ESP-IDF builds:
+ * - Short press (<3s) runs for 10 seconds.
+ * - Long press (>=3s) runs as long as the button is held.
+ * Transitions are returned as events; LEDs, IR, BLE and statistics are
+ * up to the firmware.
+ */
+#pragma once
+
+#include <stdint.h>
+
+enum DeviceState {
+  STATE_IDLE,
+  STATE_CHECKING_PRESS,
+  STATE_RUNNING_SHORT,
+  STATE_RUNNING_LONG
+};
+const int NUM_DEVICE_STATES = STATE_RUNNING_LONG + 1;
+
+// Timing constants
+const uint32_t BUTTON_DEBOUNCE_MS = 50;
+const uint32_t LONG_PRESS_MS = 3000;
+const uint32_t SHORT_PRESS_DURATION_MS = 10000;
+
+enum StateEvent {
+  STATE_EVENT_NONE,
+  STATE_EVENT_ACTIVATED,    // Idle -> checking press: start glow, IR and BLE
+  STATE_EVENT_LONG_PRESS,   // Long press threshold reached, runs until release
+  STATE_EVENT_SHORT_PRESS,  // Released early, runs until the 10 s are over
+  STATE_EVENT_FINISHED      // Back to idle
+};
+
+struct StateMachine {
+  DeviceState state;
+  uint32_t lastButtonPressTime;
+  uint32_t operationStartTime;
+};
+
+StateEvent stateMachinePress(StateMachine& machine, uint32_t now);
+StateEvent stateMachineUpdate(StateMachine& machine, bool buttonDown, uint32_t now);
+bool stateMachineActive(const StateMachine& machine);
@@ -0,0 +1,134 @@
+#include "supply_monitor.h"
+
+#include <string.h>
+
+// Level 0 is the normal drive; later levels trade cadence first, then duty
+const SupplyDrive SUPPLY_DRIVE_LEVELS[NUM_SUPPLY_LEVELS] = {
+  {0, IR_DUTY_PERCENT},
+  {5, IR_DUTY_PERCENT},
+  {10, 30},
+  {20, 28},
+  {35, 25},
+  {50, 22},
+  {80, 20},
+  {120, 17},
+  {200, 15},
+};
+
+/**
+ * @brief Resets the monitor; after a brownout reset it starts throttled
+ */
+void supplyMonitorInit(SupplyMonitor& monitor, bool enabled, bool afterBrownout) {
+  memset(&monitor, 0, sizeof(monitor));
+  monitor.enabled = enabled;
+  if (enabled && afterBrownout) {
+    monitor.level = SUPPLY_BROWNOUT_START_LEVEL;
+    monitor.peakLevel = monitor.level;
+  }
+}
+
+/**
+ * @brief True if the firmware should take a battery sample now
+ */
+bool supplySampleDue(const SupplyMonitor& monitor, uint32_t now) {
+  return monitor.enabled && (monitor.samples == 0 || now - monitor.lastSampleMs >= SUPPLY_SAMPLE_MS);
+}
+
+/**
+ * @brief Where in a burst the loaded reading starts, false if no mark is long enough
+ *
+ * Picks the first mark that covers the settle time plus a whole reading,
+ * so the sample always sees the LED fully on.
+ */
+bool supplyLoadedSampleOffset(const IRWaveform& wave, uint32_t& offsetUs) {
+  uint32_t markStartUs = 0;
+  for (int i = 0; i < wave.count; i++) {
+    if (i % 2 == 0 && wave.durations[i] >= SUPPLY_LOAD_SETTLE_US + SUPPLY_LOAD_READ_US) {
+      offsetUs = markStartUs + SUPPLY_LOAD_SETTLE_US;
+      return true;
+    }
+    markStartUs += wave.durations[i];
+  }
+  return false;
+}
+
+/**
+ * @brief Margin of the smoothed loaded battery voltage over SUPPLY_CRITICAL_MV
+ */
+int32_t supplyMarginMv(const SupplyMonitor& monitor) {
+  return (int32_t)monitor.filteredMv - SUPPLY_CRITICAL_MV;
+}
+
+/**
+ * @brief How far the battery dropped under the latest burst
+ */
+int32_t supplySagMv(const SupplyMonitor& monitor) {
+  return (int32_t)monitor.restMv - monitor.loadMv;
+}
+
+/**
+ * @brief Drive for the current level (full drive when not monitored)
+ */
+const SupplyDrive& supplyDrive(const SupplyMonitor& monitor) {
+  return SUPPLY_DRIVE_LEVELS[monitor.enabled ? monitor.level : 0];
+}
+
+/**
+ * @brief Adds a sample pair taken around a frame start and adjusts the drive level
+ */
+SupplyDecision supplyMonitorUpdate(SupplyMonitor& monitor, uint16_t restMv, uint16_t loadMv, uint32_t now) {
+  monitor.restMv = restMv;
+  monitor.loadMv = loadMv;
+  monitor.lastSampleMs = now;
+  if (monitor.samples == 0) {
+    monitor.filteredMv = loadMv;
+    monitor.minMv = loadMv;
+    monitor.lastThrottleMs = now - SUPPLY_THROTTLE_HOLD_MS;
+  } else {
+    monitor.filteredMv = (uint16_t)(((uint32_t)monitor.filteredMv * 3 + loadMv) / 4);
+    if (loadMv < monitor.minMv) {
+      monitor.minMv = loadMv;
+    }
+  }
+  monitor.samples++;
+
+  // A single deep dip is what browns out, so it is checked unsmoothed
+  int32_t dipMargin = (int32_t)loadMv - SUPPLY_CRITICAL_MV;
+  int32_t margin = supplyMarginMv(monitor);
+  bool throttleReady = now - monitor.lastThrottleMs >= SUPPLY_THROTTLE_HOLD_MS;
+  int maxLevel = NUM_SUPPLY_LEVELS - 1;
+
+  SupplyDecision decision = SUPPLY_HOLD;
+  if (dipMargin < SUPPLY_PANIC_MARGIN_MV && monitor.level < maxLevel && throttleReady) {
+    int level = monitor.level + SUPPLY_PANIC_STEP;
+    monitor.level = level > maxLevel ? maxLevel : level;
+    decision = SUPPLY_PANIC;
+  } else if (margin < SUPPLY_TARGET_MARGIN_MV && monitor.level < maxLevel && throttleReady) {
+    monitor.level++;
+    decision = SUPPLY_THROTTLE;
+  }
+
+  if (decision != SUPPLY_HOLD) {
+    monitor.lastThrottleMs = now;
+    monitor.releasePending = false;
+    monitor.throttles++;
+    if (monitor.level > monitor.peakLevel) {
+      monitor.peakLevel = monitor.level;
+    }
+    return decision;
+  }
+
+  // Release one level at a time after a comfortable stretch
+  if (margin < SUPPLY_RELEASE_MARGIN_MV || monitor.level == 0) {
+    monitor.releasePending = false;
+  } else if (!monitor.releasePending) {
+    monitor.releasePending = true;
+    monitor.releaseSinceMs = now;
+  } else if (now - monitor.releaseSinceMs >= SUPPLY_RELEASE_HOLD_MS) {
+    monitor.level--;
+    monitor.releaseSinceMs = now; // The next level needs its own stretch
+    monitor.releases++;
+    return SUPPLY_RELEASE;
+  }
+  return SUPPLY_HOLD;
+}
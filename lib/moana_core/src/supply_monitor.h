@@ -0,0 +1,78 @@
+/*
+ * Battery sag control for the IR drive. Back-to-back bursts pull current
+ * spikes through the IR LED; on tired cells the supply sags until the 3.3 V
+ * regulator drops out and the chip resets on brownout. The firmware samples
+ * the battery twice per sampled burst: under load, inside the burst's first
+ * long mark once the sag has settled (supplyLoadedSampleOffset), and at
+ * rest, at the end of the burst once its protocol padding has let the
+ * supply recover. With two emitters a burst is only sampled while the other
+ * one is dark. NEC, Samsung, Sony and RC6 open with a leader mark of 2.4 ms
+ * or more; Sharp has no leader and only 260 us marks, so its bursts are not
+ * sampled and the pair is taken on the next burst that has one. Control runs on the loaded reading, since that is the dip that
+ * browns out; rest minus loaded is the sag, reported for diagnostics. The
+ * monitor picks a drive level (extra gap after each frame, lower carrier
+ * duty) that keeps the loaded supply above SUPPLY_CRITICAL_MV with some
+ * margin.
+ *
+ * It throttles fast and releases slowly: one level up whenever the margin
+ * falls below target (several at once on a deep dip), one level down only
+ * after the margin has stayed comfortable for SUPPLY_RELEASE_HOLD_MS. The
+ * drive therefore settles at the highest throughput the cells can sustain.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "ir_encoder.h"
+
+const uint16_t SUPPLY_CRITICAL_MV = 3400;       // Battery voltage where the regulator drops out
+const uint16_t SUPPLY_TARGET_MARGIN_MV = 300;   // Throttle below this margin
+const uint16_t SUPPLY_PANIC_MARGIN_MV = 120;    // Throttle SUPPLY_PANIC_STEP levels below this
+const uint16_t SUPPLY_RELEASE_MARGIN_MV = 450;  // Release above this margin...
+const uint32_t SUPPLY_RELEASE_HOLD_MS = 2000;   // ...once it has held this long
+const uint32_t SUPPLY_THROTTLE_HOLD_MS = 250;   // Let a step take effect before the next one
+const uint32_t SUPPLY_SAMPLE_MS = 20;           // Minimum time between samples
+const uint32_t SUPPLY_LOAD_SETTLE_US = 200;     // LED current and supply sag settle this long into a mark
+const uint32_t SUPPLY_LOAD_READ_US = 400;       // Budget of one averaged loaded reading
+const int SUPPLY_PANIC_STEP = 3;
+const int SUPPLY_BROWNOUT_START_LEVEL = 4;      // Start level after a brownout reset
+
+// What one drive level does to the IR output
+struct SupplyDrive {
+  uint16_t extraGapMs;   // Added to the pacing gap after each frame
+  uint8_t dutyPercent;   // IR carrier duty cycle
+};
+
+const int NUM_SUPPLY_LEVELS = 9;
+extern const SupplyDrive SUPPLY_DRIVE_LEVELS[NUM_SUPPLY_LEVELS];
+
+enum SupplyDecision {
+  SUPPLY_HOLD,      // Level unchanged
+  SUPPLY_THROTTLE,  // One level down in drive
+  SUPPLY_PANIC,     // Several levels down in drive
+  SUPPLY_RELEASE    // One level up in drive
+};
+
+struct SupplyMonitor {
+  bool enabled;              // Battery sense fitted; otherwise always full drive
+  uint8_t level;             // Index into SUPPLY_DRIVE_LEVELS
+  uint8_t peakLevel;         // Highest level since boot
+  uint16_t restMv;           // Latest sample at the end of a burst
+  uint16_t loadMv;           // Latest sample during a burst
+  uint16_t filteredMv;       // Smoothed loaded samples (1/4 weight per sample)
+  uint16_t minMv;            // Lowest loaded sample since boot
+  uint32_t lastSampleMs;
+  uint32_t lastThrottleMs;
+  uint32_t releaseSinceMs;   // Start of the current comfortable stretch
+  bool releasePending;       // Margin is above SUPPLY_RELEASE_MARGIN_MV
+  uint32_t samples;
+  uint32_t throttles;        // Throttle and panic decisions
+  uint32_t releases;
+};
+
+void supplyMonitorInit(SupplyMonitor& monitor, bool enabled, bool afterBrownout);
+bool supplySampleDue(const SupplyMonitor& monitor, uint32_t now);
+bool supplyLoadedSampleOffset(const IRWaveform& wave, uint32_t& offsetUs);
+SupplyDecision supplyMonitorUpdate(SupplyMonitor& monitor, uint16_t restMv, uint16_t loadMv, uint32_t now);
+int32_t supplySagMv(const SupplyMonitor& monitor);
+int32_t supplyMarginMv(const SupplyMonitor& monitor);
+const SupplyDrive& supplyDrive(const SupplyMonitor& monitor);
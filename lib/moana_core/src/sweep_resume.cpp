@@ -0,0 +1,50 @@
+#include "sweep_resume.h"
+
+#include <stddef.h>
+
+/**
+ * @brief FNV-1a checksum of a resume record, excluding the checksum field
+ */
+uint32_t sweepStateChecksum(const SweepResumeState& state) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&state);
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < offsetof(SweepResumeState, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * @brief Builds the resume record for the current sweep position
+ */
+void sweepStateCapture(const IRSweep& sweep, SweepResumeState& state) {
+  SweepResumeState record = {};
+  record.magic = SWEEP_RESUME_MAGIC;
+  record.commandCount = numCommands;
+  record.position = sweep.position;
+  record.sweepOrder = irSweepPacing(sweep).sweepOrder;
+  record.rc6Toggle = sweep.rc6Toggle;
+  record.checksum = sweepStateChecksum(record);
+  state = record;
+}
+
+/**
+ * @brief Restores the sweep position from a resume record if it is valid
+ */
+SweepResumeResult sweepStateRestore(const SweepResumeState& state, IRSweep& sweep) {
+  bool valid = state.magic == SWEEP_RESUME_MAGIC &&
+               state.checksum == sweepStateChecksum(state) &&
+               state.commandCount == numCommands &&
+               state.position < numCommands;
+  if (!valid) {
+    return SWEEP_RESUME_INVALID;
+  }
+
+  sweep.rc6Toggle = state.rc6Toggle;
+  if (state.sweepOrder != irSweepPacing(sweep).sweepOrder) {
+    // Position refers to another visiting order
+    return SWEEP_RESUME_ORDER_CHANGED;
+  }
+  sweep.position = state.position;
+  return SWEEP_RESUME_OK;
+}
@@ -0,0 +1,34 @@
+/*
+ * Sweep resume record. The firmware keeps one in RTC memory, which survives
+ * software resets, watchdog and brownout resets and deep sleep (but not a
+ * power cycle). Every activation then continues where the previous one
+ * stopped instead of re-sending the head of irCommands[], so full coverage
+ * takes as few presses as possible. RTC_NOINIT_ATTR is never initialized by
+ * the startup code, so a magic value and checksum tell real state from noise.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "ir_sweep.h"
+
+const uint32_t SWEEP_RESUME_MAGIC = 0x4D4F414E; // "MOAN"
+
+struct SweepResumeState {
+  uint32_t magic;
+  uint16_t commandCount;  // numCommands when saved; a changed table invalidates it
+  uint8_t position;       // Next sweep position
+  uint8_t sweepOrder;     // Order the position refers to
+  uint8_t rc6Toggle;
+  uint8_t reserved[3];
+  uint32_t checksum;      // FNV-1a over all fields above
+};
+
+enum SweepResumeResult {
+  SWEEP_RESUME_INVALID,        // No usable record; the sweep starts from the top
+  SWEEP_RESUME_ORDER_CHANGED,  // Only the RC6 toggle was restored
+  SWEEP_RESUME_OK              // Position and toggle restored
+};
+
+uint32_t sweepStateChecksum(const SweepResumeState& state);
+void sweepStateCapture(const IRSweep& sweep, SweepResumeState& state);
+SweepResumeResult sweepStateRestore(const SweepResumeState& state, IRSweep& sweep);
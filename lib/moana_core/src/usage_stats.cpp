@@ -0,0 +1,68 @@
+#include "usage_stats.h"
+
+/**
+ * @brief Counts this boot once the stored counters are in usage.stats
+ */
+void usageTrackerStart(UsageTracker& usage, uint32_t now) {
+  usage.stats.bootCount++;
+  usage.dirty = true;
+  usage.lastSample = now;
+  usage.lastFlush = now;
+  usage.flushCount = 0;
+}
+
+/**
+ * @brief Accumulates time counters (every loop)
+ * @return true if the idle flush policy wants the counters written now
+ */
+bool usageTrackerService(UsageTracker& usage, DeviceState state, uint32_t now) {
+  uint32_t elapsed = now - usage.lastSample;
+  usage.lastSample = now;
+  usage.stats.uptimeMs += elapsed;
+  usage.stats.stateTimeMs[state] += elapsed;
+
+  // Never write while a sweep is running
+  if (state != STATE_IDLE) {
+    return false;
+  }
+
+  uint32_t sinceFlush = now - usage.lastFlush;
+  return (usage.dirty && sinceFlush >= STATS_FLUSH_INTERVAL_MS) ||
+         sinceFlush >= STATS_TIME_FLUSH_INTERVAL_MS;
+}
+
+/**
+ * @brief True if pending events should be flushed as an activation ends (rate limited)
+ */
+bool usageTrackerActivationEndDue(const UsageTracker& usage, uint32_t now) {
+  return usage.dirty && now - usage.lastFlush >= STATS_MIN_FLUSH_INTERVAL_MS;
+}
+
+/**
+ * @brief Marks the counters as written to NVS
+ */
+void usageTrackerFlushed(UsageTracker& usage, uint32_t now) {
+  usage.dirty = false;
+  usage.lastFlush = now;
+  usage.flushCount++;
+}
+
+/**
+ * @brief Counts a short or long press
+ */
+void usageTrackerRecordPress(UsageTracker& usage, bool longPress) {
+  if (longPress) {
+    usage.stats.longPresses++;
+  } else {
+    usage.stats.shortPresses++;
+  }
+  usage.dirty = true;
+}
+
+/**
+ * @brief Counts the frames of one burst (full frame plus repeats)
+ */
+void usageTrackerRecordBurst(UsageTracker& usage, int command, uint16_t repeats) {
+  usage.stats.framesPerCode[command] += 1 + repeats;
+  usage.dirty = true;
+}
@@ -0,0 +1,50 @@
+/*
+ * Lifetime usage counters and their NVS flush policy. The firmware owns the
+ * NVS handle; this module only decides when a write is due.
+ *
+ * Counters are kept in RAM and written to NVS as one blob in batches, so
+ * flash wear and write stalls stay low:
+ * - when an activation ends, if events are pending and the last flush is
+ *   at least STATS_MIN_FLUSH_INTERVAL_MS old
+ * - while idle, once pending events are STATS_FLUSH_INTERVAL_MS old
+ * - while idle, every STATS_TIME_FLUSH_INTERVAL_MS for the time counters
+ * - immediately around OTA, which ends in a reboot
+ * Flushes never happen during a sweep, so they cannot delay IR frames.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "ir_codes.h"
+#include "state_machine.h"
+
+const uint32_t STATS_MIN_FLUSH_INTERVAL_MS = 30000;
+const uint32_t STATS_FLUSH_INTERVAL_MS = 300000;
+const uint32_t STATS_TIME_FLUSH_INTERVAL_MS = 3600000;
+
+// Stored as-is under "stats"/"lifetime"; both builds share the layout
+struct UsageStats {
+  uint32_t bootCount;
+  uint32_t shortPresses;
+  uint32_t longPresses;
+  uint32_t otaAttempts;
+  uint32_t otaFailures;
+  uint32_t reserved;
+  uint64_t uptimeMs;
+  uint64_t stateTimeMs[NUM_DEVICE_STATES];
+  uint32_t framesPerCode[numCommands];
+};
+
+struct UsageTracker {
+  UsageStats stats;
+  bool dirty;               // Events recorded since the last flush
+  uint32_t lastFlush;
+  uint32_t lastSample;
+  uint32_t flushCount;      // NVS writes since boot
+};
+
+void usageTrackerStart(UsageTracker& usage, uint32_t now);
+bool usageTrackerService(UsageTracker& usage, DeviceState state, uint32_t now);
+bool usageTrackerActivationEndDue(const UsageTracker& usage, uint32_t now);
+void usageTrackerFlushed(UsageTracker& usage, uint32_t now);
+void usageTrackerRecordPress(UsageTracker& usage, bool longPress);
+void usageTrackerRecordBurst(UsageTracker& usage, int command, uint16_t repeats);
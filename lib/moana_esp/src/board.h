@@ -0,0 +1,59 @@
+/*
+ * Pin map of the ESP32-C3 Super Mini inside the oar, shared by the Arduino
+ * and ESP-IDF builds.
+ */
+#pragma once
+
+#include <driver/rmt.h>
+
+// --- Pin Definitions for ESP32-C3 Super Mini ---
+// Available GPIO pins: 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 20, 21
+// Avoid: GPIO 11-17 (SPI Flash), GPIO 18-19 (USB), GPIO 12-13 (SPI)
+const int IR_LED_PIN = 2;     // GPIO 2 - Safe for output, commonly used for LEDs
+const int LED1_PIN   = 6;     // GPIO 6 - Safe for output
+const int LED2_PIN   = 4;     // GPIO 4 - Safe for output
+const int LED3_PIN   = 5;     // GPIO 5 - Safe for output
+const int BUTTON_PIN = 3;     // GPIO 3 - Safe for input, active-high button with external pulldown
+const int SWITCH_PIN = 7;     // GPIO 7 - Safe for input with external pulldown
+const int DEBUG_LED_PIN = 8;  // GPIO 8 - Safe for output, debug LED
+
+// --- IR Emitters ---
+// Each IR LED is driven by its own RMT TX channel, so frames go out in
+// hardware and emitters transmit in parallel, each with its own carrier.
+// The ESP32-C3 has two RMT TX channels. A second emitter is optional: fit
+// another IR LED + 39 ohm resistor on a spare GPIO (e.g. 10) and build with
+// -D IR_LED2_PIN=10. IR LEDs are active-low, so the RMT output is inverted
+// and the pin idles HIGH (off).
+struct IREmitter {
+  int pin;
+  rmt_channel_t channel;
+};
+
+const IREmitter IR_EMITTERS[] = {
+  {IR_LED_PIN, RMT_CHANNEL_0},
+#ifdef IR_LED2_PIN
+  {IR_LED2_PIN, RMT_CHANNEL_1},
+#endif
+};
+const int NUM_IR_EMITTERS = sizeof(IR_EMITTERS) / sizeof(IR_EMITTERS[0]);
+
+// --- Battery Sense (optional) ---
+// With VBAT fed through a 100k/100k divider into an ADC1 pin, the firmware
+// samples the batteries between IR frames and backs off the IR drive before
+// they sag into a brownout (supply_monitor.h). GPIO 0 and 1 are the free
+// ADC1 pins; build with e.g. -D BATTERY_SENSE_PIN=1. Without it the IR
+// drive is never throttled.
+const int BATTERY_DIVIDER_RATIO = 2;   // VBAT / ADC pin voltage
+const int BATTERY_SAMPLES = 4;         // ADC reads averaged per sample
+
+// --- LED PWM Configuration for "Magical Glow" ---
+// The ESP-IDF build drives the glow LEDs from the LEDC peripheral
+const int LED1_CHAN = 0; // PWM Channel 0
+const int LED2_CHAN = 1; // PWM Channel 1
+const int LED3_CHAN = 2; // PWM Channel 2
+const int PWM_FREQ = 5000; // PWM frequency in Hz
+const int PWM_RESOLUTION = 8; // 8-bit resolution (0-255)
+
+// --- Demo / OTA Mode Access Point ---
+const char* const OTA_SSID = "REMO MAGICO!";
+const char* const OTA_PASSWORD = "moana123";
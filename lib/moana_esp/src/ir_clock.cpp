@@ -0,0 +1,57 @@
+#include "ir_clock.h"
+#include "board.h"
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+static esp_timer_handle_t clockTimers[NUM_IR_EMITTERS];
+static void (*clockFrameDue)(int emitter) = NULL;
+static SemaphoreHandle_t clockLock = NULL;
+static StaticSemaphore_t clockLockBuffer;
+
+/**
+ * @brief esp_timer callback: runs the firmware's frame handler under the lock
+ */
+static void onClockTimer(void* arg) {
+  irClockLock();
+  clockFrameDue((int)(intptr_t)arg);
+  irClockUnlock();
+}
+
+/**
+ * @brief Creates one timer per emitter (at boot; creating timers allocates)
+ */
+bool irClockInstall(void (*frameDue)(int emitter)) {
+  clockFrameDue = frameDue;
+  clockLock = xSemaphoreCreateMutexStatic(&clockLockBuffer);
+
+  for (int e = 0; e < NUM_IR_EMITTERS; e++) {
+    esp_timer_create_args_t args = {};
+    args.callback = onClockTimer;
+    args.arg = (void*)(intptr_t)e;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "ir_clock";
+    if (esp_timer_create(&args, &clockTimers[e]) != ESP_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Arms an emitter's timer for a frame starting at startUs (restarts it if armed)
+ */
+void irClockSchedule(int emitter, uint32_t startUs) {
+  int32_t wait = (int32_t)(startUs - IR_CLOCK_LEAD_US - (uint32_t)esp_timer_get_time());
+  esp_timer_stop(clockTimers[emitter]); // Not armed is fine
+  esp_timer_start_once(clockTimers[emitter], wait > 0 ? wait : 0);
+}
+
+void irClockLock() {
+  xSemaphoreTake(clockLock, portMAX_DELAY);
+}
+
+void irClockUnlock() {
+  xSemaphoreGive(clockLock);
+}
@@ -0,0 +1,24 @@
+/*
+ * Frame clock for the IR emitters, shared by the Arduino and ESP-IDF
+ * builds. Each emitter has a one-shot esp_timer that fires IR_CLOCK_LEAD_US
+ * before its next frame is due; the frameDue callback (ir_transmit.cpp)
+ * prepares the burst (encode, pack) in that lead time and then starts it
+ * on the scheduled microsecond (irEmitterStart). Frame
+ * spacing therefore no longer depends on what loop() is doing.
+ *
+ * The callback runs in the esp_timer task, shared by all emitters, so it
+ * must not block or print. It holds the clock lock while it runs; loop()
+ * code that touches the sweep, usage counters or emitter state takes the
+ * same lock (irClockLock/irClockUnlock) and releases it around flash writes
+ * (persistence.h).
+ */
+#pragma once
+
+#include <stdint.h>
+
+const uint32_t IR_CLOCK_LEAD_US = 300; // Must stay below the 1 ms minimum frame gap
+
+bool irClockInstall(void (*frameDue)(int emitter));
+void irClockSchedule(int emitter, uint32_t startUs);
+void irClockLock();
+void irClockUnlock();
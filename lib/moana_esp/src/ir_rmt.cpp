@@ -0,0 +1,112 @@
+#include "ir_rmt.h"
+
+#include <esp_timer.h>
+
+/**
+ * @brief Installs the RMT TX channel of one emitter
+ */
+bool irEmitterInstall(const IREmitter& emitter, IREmitterState& state, uint32_t nowUs) {
+  rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)emitter.pin, emitter.channel);
+  config.clk_div = 80; // 80 MHz APB / 80 = 1 us ticks
+  config.mem_block_num = 1;
+  config.tx_config.carrier_en = true;
+  config.tx_config.carrier_freq_hz = NEC_CARRIER_HZ;
+  config.tx_config.carrier_duty_percent = IR_DUTY_PERCENT;
+  config.tx_config.carrier_level = RMT_CARRIER_LEVEL_HIGH;
+  config.tx_config.idle_output_en = true;
+  config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+
+  esp_err_t err = rmt_config(&config);
+  if (err == ESP_OK) {
+    // Active-low LED: invert the channel output so idle LOW drives the pin HIGH
+    err = rmt_set_gpio(emitter.channel, RMT_MODE_TX, (gpio_num_t)emitter.pin, true);
+  }
+  if (err == ESP_OK) {
+    err = rmt_driver_install(emitter.channel, 0, 0);
+  }
+
+  state.ready = (err == ESP_OK);
+  state.carrierHz = NEC_CARRIER_HZ;
+  state.dutyPercent = IR_DUTY_PERCENT;
+  state.readyAtUs = nowUs;
+  return state.ready;
+}
+
+/**
+ * @brief True if the emitter is installed and RMT has finished its last burst
+ */
+bool irEmitterIdle(const IREmitter& emitter, const IREmitterState& state) {
+  return state.ready && rmt_wait_tx_done(emitter.channel, 0) == ESP_OK;
+}
+
+/**
+ * @brief Packs a burst into the emitter's items and programs its carrier (emitter must be idle)
+ *
+ * dutyPercent is normally IR_DUTY_PERCENT; the supply monitor lowers it to
+ * cut LED current on sagging batteries.
+ */
+void irEmitterLoad(const IREmitter& emitter, IREmitterState& state, const IRWaveform& wave, uint8_t dutyPercent) {
+  state.itemCount = irPackRmtItems(wave, state.items, IR_MAX_RMT_ITEMS);
+  state.burstUs = wave.totalUs;
+
+  if (wave.carrierHz != state.carrierHz || dutyPercent != state.dutyPercent) {
+    // Carrier high/low times are counted in source clock cycles
+    uint32_t period = RMT_SOURCE_CLK_HZ / wave.carrierHz;
+    uint32_t high = period * dutyPercent / 100;
+    rmt_set_tx_carrier(emitter.channel, true, high, period - high, RMT_CARRIER_LEVEL_HIGH);
+    state.carrierHz = wave.carrierHz;
+    state.dutyPercent = dutyPercent;
+  }
+}
+
+/**
+ * @brief Starts the loaded burst at startUs; the next one is due gapUs after it ends
+ *
+ * Busy-waits for the last microseconds so the start does not depend on
+ * timer dispatch latency. Returns when the burst really started: the clock
+ * is read once rmt_write_items() has filled the channel and started it.
+ */
+uint32_t irEmitterStart(const IREmitter& emitter, IREmitterState& state, uint32_t startUs, uint32_t gapUs) {
+  while ((int32_t)((uint32_t)esp_timer_get_time() - startUs) < 0) {
+  }
+  rmt_write_items(emitter.channel, state.items, state.itemCount, false);
+  uint32_t startedUs = (uint32_t)esp_timer_get_time();
+
+  // The gap counts from the real start, so a late frame never shortens it
+  state.startedUs = startedUs;
+  state.readyAtUs = startedUs + state.burstUs + gapUs;
+  state.bursts++;
+  state.busyUs += state.burstUs;
+  return startedUs;
+}
+
+/**
+ * @brief Packs a waveform into RMT items (1 us ticks), returns the item count
+ */
+int irPackRmtItems(const IRWaveform& wave, rmt_item32_t* items, int maxItems) {
+  int half = 0; // Index of the next half item
+  for (int i = 0; i < wave.count; i++) {
+    uint32_t level = (i % 2 == 0) ? 1 : 0; // Marks are driven high, then inverted on the pin
+    uint32_t remaining = wave.durations[i];
+    // Long gaps do not fit one 15-bit duration field and are split
+    while (remaining > 0 && half < 2 * maxItems) {
+      uint32_t chunk = remaining > RMT_MAX_DURATION ? RMT_MAX_DURATION : remaining;
+      rmt_item32_t& item = items[half / 2];
+      if (half % 2 == 0) {
+        item.duration0 = chunk;
+        item.level0 = level;
+      } else {
+        item.duration1 = chunk;
+        item.level1 = level;
+      }
+      remaining -= chunk;
+      half++;
+    }
+  }
+  if (half % 2 == 1) {
+    // Zero duration in the second half marks the end of transmission
+    items[half / 2].duration1 = 0;
+    items[half / 2].level1 = 0;
+  }
+  return (half + 1) / 2;
+}
@@ -0,0 +1,39 @@
+/*
+ * RMT driver for the IR emitters, shared by the Arduino and ESP-IDF builds
+ * (both sit on the same ESP-IDF RMT driver). Bursts are packed into the
+ * emitter's own item buffer and transmitted in the background.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <driver/rmt.h>
+#include "board.h"
+#include "ir_encoder.h"
+
+const int IR_MAX_RMT_ITEMS = 512;  // Durations / 2 plus splits of long gaps
+const uint32_t RMT_MAX_DURATION = 32767; // 15-bit item field, 1 us ticks
+const uint32_t RMT_SOURCE_CLK_HZ = 80000000; // APB clock, also times the carrier
+
+// The sweep is dispatched across the emitters: whenever an emitter is free
+// (its burst and the pacing gap are over, see ir_clock.h) it takes the next
+// code in sweep order. Emitters therefore split the sweep by airtime, not by
+// count. Only different carriers (38 kHz NEC, 40 kHz Sony) go out at the
+// same time; same-carrier frames take turns (ir_dispatch.h).
+struct IREmitterState {
+  rmt_item32_t items[IR_MAX_RMT_ITEMS]; // Must stay valid while RMT transmits
+  int itemCount;             // Items of the loaded burst
+  uint32_t burstUs;          // Duration of the loaded burst
+  uint32_t readyAtUs;        // Scheduled start of this emitter's next burst
+  uint32_t startedUs;        // Real start of its last burst
+  uint32_t carrierHz;        // Carrier currently programmed
+  uint8_t dutyPercent;       // Carrier duty currently programmed
+  uint32_t bursts;           // Bursts sent this activation
+  uint64_t busyUs;           // Burst time this activation
+  bool ready;                // RMT channel installed
+};
+
+bool irEmitterInstall(const IREmitter& emitter, IREmitterState& state, uint32_t nowUs);
+bool irEmitterIdle(const IREmitter& emitter, const IREmitterState& state);
+void irEmitterLoad(const IREmitter& emitter, IREmitterState& state, const IRWaveform& wave, uint8_t dutyPercent);
+uint32_t irEmitterStart(const IREmitter& emitter, IREmitterState& state, uint32_t startUs, uint32_t gapUs);
+int irPackRmtItems(const IRWaveform& wave, rmt_item32_t* items, int maxItems);
@@ -0,0 +1,418 @@
+#include "ir_transmit.h"
+#include "board.h"
+#include "console.h"
+#include "frame_timing.h"
+#include "ir_clock.h"
+#include "ir_dispatch.h"
+#include "ir_encoder.h"
+#include "ir_rmt.h"
+#include "persistence.h"
+
+#include <string.h>
+#include <esp_rom_sys.h>
+#include <esp_task.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+const uint32_t SUPPLY_TASK_STACK_BYTES = 3072;
+const uint32_t SUPPLY_WAKE_EARLY_US = 100; // Left to a ROM delay after the wake-up timer
+
+static IrTransmitContext transmit;
+
+// Current activation: signal time the LEDs were driven (irFrameAirtimeUs)
+// and the wall time the bursts occupied the emitters, padding included
+static uint64_t irAirtimeUs = 0;
+static uint64_t irBurstTimeUs = 0;
+
+static IRWaveform irWaveform; // Scratch buffer, repacked into the emitter's items right away
+static IREmitterState irEmitterState[NUM_IR_EMITTERS];
+static FrameTiming irFrameTiming; // Start-to-start error of consecutive frames, this activation
+static IRAirSlot irAirSlots[NUM_IR_EMITTERS]; // What each emitter has on air, and until when
+
+// A burst loaded into its emitter, waiting for its start
+struct PreparedBurst {
+  int emitter;
+  uint32_t startUs;
+  uint32_t gapUs;
+  uint32_t nowMs;
+  bool sampleSupply;
+  uint32_t loadOffsetUs;  // Loaded battery sample, from the burst start
+};
+
+// Battery sample pair handed from the frame clock to the supply task
+struct SupplyRequest {
+  uint32_t loadAtUs;      // Inside the burst's first long mark
+  uint32_t restAtUs;      // End of the burst: its protocol padding let the supply recover
+  uint32_t nowMs;
+};
+static SupplyRequest supplyRequest;
+static volatile bool supplyRequestPending = false;
+static TaskHandle_t supplyTask = NULL;
+static StaticTask_t supplyTaskBuffer;
+static StackType_t supplyTaskStack[SUPPLY_TASK_STACK_BYTES];
+static esp_timer_handle_t supplyWakeTimer = NULL;
+static SemaphoreHandle_t supplyWake = NULL;
+static StaticSemaphore_t supplyWakeBuffer;
+
+// Left by the frame clock and the supply task, printed by irTransmitService()
+struct TransmitReports {
+  uint32_t truncatedBursts;
+  bool supplyChanged;
+  SupplyDecision supplyDecision;
+  bool abSweepDone;
+  IRSweepStep abSweep;
+};
+static TransmitReports irReports;
+
+/**
+ * @brief Microsecond clock shared with the RMT start times
+ */
+static uint32_t nowUs() {
+  return (uint32_t)esp_timer_get_time();
+}
+
+/**
+ * @brief Milliseconds since boot (millis() in the Arduino build)
+ */
+static uint32_t nowMs() {
+  return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/**
+ * @brief True if atUs is still ahead, but not so far that it must be from before a clock wrap
+ */
+static bool pendingWithin10s(uint32_t atUs, uint32_t now) {
+  uint32_t pendingUs = atUs - now;
+  return (int32_t)pendingUs > 0 && pendingUs < 10000000UL;
+}
+
+/**
+ * @brief Wake-up timer callback (esp_timer task): resumes the supply task
+ */
+static void onSupplyWake(void* arg) {
+  xSemaphoreGive(supplyWake);
+}
+
+/**
+ * @brief Blocks until atUs; returns how late the supply task got there
+ *
+ * Sleeps on a one-shot timer until SUPPLY_WAKE_EARLY_US before atUs and
+ * covers the rest with a ROM delay, so the task never spins for long at
+ * its priority, which is above the loop and the BLE tasks.
+ */
+static uint32_t waitUntilUs(uint32_t atUs) {
+  int32_t sleepUs = (int32_t)(atUs - nowUs()) - (int32_t)SUPPLY_WAKE_EARLY_US;
+  if (sleepUs > 0) {
+    esp_timer_start_once(supplyWakeTimer, sleepUs);
+    xSemaphoreTake(supplyWake, portMAX_DELAY);
+  }
+  int32_t remainingUs = (int32_t)(atUs - nowUs());
+  if (remainingUs > 0) {
+    esp_rom_delay_us(remainingUs);
+    return 0;
+  }
+  return (uint32_t)-remainingUs;
+}
+
+/**
+ * @brief Supply task: takes the battery sample pairs the frame clock asks for
+ *
+ * Runs one priority below the esp_timer task, so the ADC reads and the
+ * waits for the sample times never hold up a frame on any emitter. The
+ * wake-up timer fires in the esp_timer task, which may be busy starting a
+ * frame; a loaded reading that would start that late could slip out of
+ * its mark, so the pair is dropped.
+ */
+static void supplyTaskMain(void* arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    SupplyRequest request = supplyRequest;
+
+    bool onTime = waitUntilUs(request.loadAtUs) <= SUPPLY_WAKE_EARLY_US;
+    uint16_t loadMv = onTime ? transmit.readBatteryMv() : 0;
+    if (onTime) {
+      waitUntilUs(request.restAtUs);
+    }
+    uint16_t restMv = onTime ? transmit.readBatteryMv() : 0;
+
+    irClockLock();
+    if (onTime) {
+      SupplyDecision decision = supplyMonitorUpdate(*transmit.supply, restMv, loadMv, request.nowMs);
+      if (decision != SUPPLY_HOLD) {
+        irReports.supplyChanged = true;
+        irReports.supplyDecision = decision;
+      }
+    }
+    supplyRequestPending = false;
+    irClockUnlock();
+  }
+}
+
+/**
+ * @brief True if no other emitter can light its LED between fromUs and toUs
+ */
+static bool otherEmittersQuiet(int emitter, uint32_t fromUs, uint32_t toUs) {
+  for (int e = 0; e < NUM_IR_EMITTERS; e++) {
+    if (e != emitter && irEmitterState[e].ready && !irAirSlotQuiet(irAirSlots[e], fromUs, toUs)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Loads the next IR code of the sweep into an emitter; false if its frame waits
+ *
+ * Short press sends one press per target; long press sends a held-button
+ * burst (see IRPacing) using the protocol's compact repeat form. If another
+ * emitter has the next code's carrier on air, the emitter's clock is
+ * re-armed for the end of that frame and its gap (ir_dispatch.h).
+ */
+static bool prepareBurst(int emitter, PreparedBurst& burst) {
+  IRSweep& sweep = *transmit.sweep;
+  SupplyMonitor& supply = *transmit.supply;
+  IREmitterState& state = irEmitterState[emitter];
+  if (!irEmitterIdle(IR_EMITTERS[emitter], state)) {
+    irClockSchedule(emitter, nowUs() + IR_CLOCK_LEAD_US); // Should not happen: gaps are >= 1 ms
+    return false;
+  }
+  uint32_t carrierHz = irCarrierHz(irCommands[irSweepNextCommand(sweep)].protocol);
+  uint32_t dispatchUs = irDispatchStart(irAirSlots, NUM_IR_EMITTERS, emitter, carrierHz, state.readyAtUs);
+  if (dispatchUs != state.readyAtUs) {
+    state.readyAtUs = dispatchUs;
+    irClockSchedule(emitter, dispatchUs);
+    return false;
+  }
+
+  burst.emitter = emitter;
+  burst.startUs = state.readyAtUs;
+  uint16_t gapMs = irSweepPacing(sweep).frameGapMs; // A/B mode may switch sets below
+  IRSweepStep step = irSweepNext(sweep, burst.startUs, transmit.machine->state == STATE_RUNNING_LONG);
+  const IRCommand& cmd = irCommands[step.command];
+
+  if (!irEncodeBurst(irWaveform, cmd, step.repeats, step.toggle)) {
+    irReports.truncatedBursts++;
+  }
+
+  // Battery samples if the burst has a mark long enough for the loaded one
+  // (not Sharp), the supply task is done with the last pair and no other
+  // emitter draws current from the burst start to the end of the rest read
+  burst.nowMs = nowMs();
+  burst.loadOffsetUs = 0;
+  burst.sampleSupply = supplyTask && !supplyRequestPending && supplySampleDue(supply, burst.nowMs) &&
+                       supplyLoadedSampleOffset(irWaveform, burst.loadOffsetUs) &&
+                       otherEmittersQuiet(emitter, burst.startUs,
+                                          burst.startUs + irWaveform.totalUs + SUPPLY_LOAD_READ_US);
+  const SupplyDrive& drive = supplyDrive(supply);
+  burst.gapUs = (gapMs + drive.extraGapMs) * 1000UL;
+  irEmitterLoad(IR_EMITTERS[emitter], state, irWaveform, drive.dutyPercent);
+
+  // The carrier is taken from here on, so an emitter prepared after this one waits for it
+  IRAirSlot& slot = irAirSlots[emitter];
+  slot.carrierHz = irWaveform.carrierHz;
+  slot.startUs = burst.startUs;
+  slot.burstEndUs = burst.startUs + irWaveform.totalUs;
+  slot.untilUs = slot.burstEndUs + burst.gapUs;
+
+  irAirtimeUs += irFrameAirtimeUs(cmd) + (uint64_t)step.repeats * irRepeatAirtimeUs(cmd);
+  irBurstTimeUs += irWaveform.totalUs;
+  usageTrackerRecordBurst(*transmit.usage, step.command, step.repeats);
+
+  if (step.sweepMeasured && sweep.abModeEnabled) {
+    irReports.abSweepDone = true;
+    irReports.abSweep = step;
+  }
+  saveSweepResumeState(sweep);
+  return true;
+}
+
+/**
+ * @brief Starts a prepared burst on its microsecond and schedules the emitter's next frame
+ */
+static void startBurst(const PreparedBurst& burst) {
+  IREmitterState& state = irEmitterState[burst.emitter];
+  uint32_t previousUs = state.startedUs;
+  uint32_t startedUs = irEmitterStart(IR_EMITTERS[burst.emitter], state, burst.startUs, burst.gapUs);
+  if (state.bursts > 1) {
+    frameTimingRecord(irFrameTiming, startedUs - previousUs, burst.startUs - previousUs);
+  }
+  IRAirSlot& slot = irAirSlots[burst.emitter];
+  slot.startUs = startedUs;
+  slot.burstEndUs = startedUs + state.burstUs;
+  slot.untilUs = state.readyAtUs;
+  irClockSchedule(burst.emitter, state.readyAtUs);
+
+  if (burst.sampleSupply) {
+    supplyRequest.loadAtUs = startedUs + burst.loadOffsetUs;
+    supplyRequest.restAtUs = startedUs + state.burstUs;
+    supplyRequest.nowMs = burst.nowMs;
+    supplyRequestPending = true;
+    xTaskNotifyGive(supplyTask);
+  }
+}
+
+/**
+ * @brief Frame clock callback: sends the next IR codes of the sweep.
+ *
+ * Runs in the esp_timer task IR_CLOCK_LEAD_US before the emitter's frame is
+ * due, with the clock lock held: the burst is prepared in the lead time,
+ * started on the scheduled microsecond, and the emitter's next frame is
+ * scheduled one gap after it. Once the activation is over the clock is
+ * simply not re-armed.
+ *
+ * All emitters share the esp_timer task, so a frame due on another emitter
+ * before this start would wait behind its busy-wait. Every emitter due by
+ * then is prepared here too and the bursts are started in time order.
+ * Nothing else blocks: battery samples are taken by the supply task and
+ * messages are printed from loop() (irTransmitService). RMT transmits the
+ * bursts in the background.
+ */
+static void onFrameDue(int emitter) {
+  if (!stateMachineActive(*transmit.machine)) {
+    return;
+  }
+
+  int due[NUM_IR_EMITTERS];
+  int dueCount = 0;
+  uint32_t horizonUs = irEmitterState[emitter].readyAtUs + IR_CLOCK_LEAD_US;
+  for (int e = 0; e < NUM_IR_EMITTERS; e++) {
+    uint32_t readyAtUs = irEmitterState[e].readyAtUs;
+    if (!irEmitterState[e].ready || (e != emitter && (int32_t)(readyAtUs - horizonUs) > 0)) {
+      continue;
+    }
+    int i = dueCount++;
+    for (; i > 0 && (int32_t)(irEmitterState[due[i - 1]].readyAtUs - readyAtUs) > 0; i--) {
+      due[i] = due[i - 1];
+    }
+    due[i] = e;
+  }
+
+  PreparedBurst bursts[NUM_IR_EMITTERS];
+  int burstCount = 0;
+  for (int i = 0; i < dueCount; i++) {
+    if (prepareBurst(due[i], bursts[burstCount])) {
+      burstCount++;
+    }
+  }
+  for (int i = 0; i < burstCount; i++) {
+    startBurst(bursts[i]);
+  }
+}
+
+/**
+ * @brief Installs an RMT TX channel for every emitter in IR_EMITTERS and the frame clock
+ */
+void irTransmitInstall(const IrTransmitContext& ctx) {
+  transmit = ctx;
+  for (int e = 0; e < NUM_IR_EMITTERS; e++) {
+    bool ready = irEmitterInstall(IR_EMITTERS[e], irEmitterState[e], nowUs());
+    consolePrintf("IR emitter on GPIO %d%s\n", IR_EMITTERS[e].pin, ready ? " ready (RMT)" : " FAILED to initialize RMT!");
+  }
+  if (!irClockInstall(onFrameDue)) {
+    consolePrintf("Failed to create the IR frame clock timers!\n");
+  }
+
+  // The supply task's wake-up timer, created at boot like the clock timers
+  supplyWake = xSemaphoreCreateBinaryStatic(&supplyWakeBuffer);
+  esp_timer_create_args_t args = {};
+  args.callback = onSupplyWake;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "ir_supply";
+  if (esp_timer_create(&args, &supplyWakeTimer) != ESP_OK) {
+    consolePrintf("Failed to create the battery sample timer!\n");
+  }
+}
+
+/**
+ * @brief Clears the activation counters and schedules the first frame on every emitter
+ *
+ * An emitter still in the burst or gap of the previous activation keeps its
+ * scheduled start and its carrier. The supply task is created with the
+ * first activation that samples the battery.
+ */
+void irTransmitBegin() {
+  irClockLock();
+  irAirtimeUs = 0;
+  irBurstTimeUs = 0;
+  irSweepBeginActivation(*transmit.sweep);
+  frameTimingReset(irFrameTiming);
+
+  if (transmit.supply->enabled && supplyWakeTimer && !supplyTask) {
+    supplyTask = xTaskCreateStatic(supplyTaskMain, "ir_supply", SUPPLY_TASK_STACK_BYTES, NULL,
+                                   ESP_TASK_TIMER_PRIO - 1, supplyTaskStack, &supplyTaskBuffer);
+  }
+
+  uint32_t now = nowUs();
+  for (int e = 0; e < NUM_IR_EMITTERS; e++) {
+    IREmitterState& state = irEmitterState[e];
+    state.bursts = 0;
+    state.busyUs = 0;
+    if (!state.ready) {
+      continue;
+    }
+
+    uint32_t start = now + IR_CLOCK_LEAD_US;
+    if (pendingWithin10s(state.readyAtUs, start)) {
+      start = state.readyAtUs;
+    }
+    IRAirSlot& slot = irAirSlots[e];
+    if (!pendingWithin10s(slot.untilUs, now)) {
+      slot.untilUs = now;
+      slot.startUs = now;
+      slot.burstEndUs = now;
+    }
+    state.readyAtUs = start;
+    irClockSchedule(e, start);
+  }
+  irClockUnlock();
+}
+
+/**
+ * @brief Prints what the frame clock and the supply task left in irReports (every loop)
+ */
+void irTransmitService() {
+  irClockLock();
+  TransmitReports reports = irReports;
+  memset(&irReports, 0, sizeof(irReports));
+  SupplyMonitor supply = *transmit.supply;
+  irClockUnlock();
+
+  if (reports.truncatedBursts > 0) {
+    consolePrintf("IR burst truncated - too many repeats for the waveform buffer (%u bursts)\n",
+                  (unsigned)reports.truncatedBursts);
+  }
+  if (reports.supplyChanged) {
+    printSupplyDecision(supply, reports.supplyDecision);
+  }
+  if (reports.abSweepDone) {
+    printAbSweep(reports.abSweep);
+  }
+}
+
+/**
+ * @brief IR part of the 5 s status line: start-to-start error, bursts, wall time per burst, airtime and IR drive
+ */
+void irTransmitPrintStatus() {
+  const SupplyMonitor& supply = *transmit.supply;
+  if (irFrameTiming.intervals > 0) {
+    consolePrintf(", IR start-to-start error: avg %u us, max %u us, %u over %u us", (unsigned)frameTimingAverageUs(irFrameTiming),
+                  (unsigned)irFrameTiming.errorMaxUs, (unsigned)irFrameTiming.overTarget,
+                  (unsigned)FRAME_JITTER_TARGET_US);
+  }
+  uint32_t bursts = 0;
+  consolePrintf(", IR bursts per emitter:");
+  for (int e = 0; e < NUM_IR_EMITTERS; e++) {
+    consolePrintf(" %u", (unsigned)irEmitterState[e].bursts);
+    bursts += irEmitterState[e].bursts;
+  }
+  if (bursts > 0) {
+    consolePrintf(" (%lu us per burst, airtime %lu ms)", (unsigned long)(irBurstTimeUs / bursts),
+                  (unsigned long)(irAirtimeUs / 1000));
+  }
+  if (supply.enabled) {
+    consolePrintf(", Supply: %u mV under load (margin %ld mV, IR drive level %u)", (unsigned)supply.filteredMv,
+                  (long)supplyMarginMv(supply), (unsigned)supply.level);
+  }
+}
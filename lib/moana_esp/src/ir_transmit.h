@@ -0,0 +1,35 @@
+/*
+ * IR transmit path shared by the Arduino and ESP-IDF builds: the emitters,
+ * the frame clock callback that hands sweep codes to them, the battery
+ * samples taken around each burst and the per-activation airtime and
+ * timing counters. The firmware only reads the ADC (readBatteryMv), starts
+ * the clock when an activation begins and calls irTransmitService() every
+ * loop.
+ *
+ * Frames go out from the esp_timer task (ir_clock.h); the battery samples
+ * are taken by a supply task one priority below it. loop() code that
+ * touches the sweep, usage counters or supply monitor takes irClockLock().
+ * Neither task prints: what they report is printed by irTransmitService()
+ * through consolePrintf().
+ */
+#pragma once
+
+#include <stdint.h>
+#include "ir_sweep.h"
+#include "state_machine.h"
+#include "supply_monitor.h"
+#include "usage_stats.h"
+
+// What the transmit path reads and updates
+struct IrTransmitContext {
+  IRSweep* sweep;
+  const StateMachine* machine;   // Frames go out while it is active
+  SupplyMonitor* supply;
+  UsageTracker* usage;
+  uint16_t (*readBatteryMv)();   // Averaged battery voltage (board ADC)
+};
+
+void irTransmitInstall(const IrTransmitContext& ctx);
+void irTransmitBegin();
+void irTransmitService();
+void irTransmitPrintStatus();
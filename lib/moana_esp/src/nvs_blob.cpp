@@ -0,0 +1,28 @@
+#include "nvs_blob.h"
+
+/**
+ * @brief Opens a namespace read/write (NVS flash must be initialized)
+ */
+bool nvsBlobOpen(NvsBlob& blob, const char* nameSpace) {
+  blob.open = (nvs_open(nameSpace, NVS_READWRITE, &blob.handle) == ESP_OK);
+  return blob.open;
+}
+
+/**
+ * @brief Reads a blob, only if it is stored with exactly `size` bytes
+ */
+bool nvsBlobLoad(const NvsBlob& blob, const char* key, void* data, size_t size) {
+  size_t stored = 0;
+  if (!blob.open || nvs_get_blob(blob.handle, key, nullptr, &stored) != ESP_OK || stored != size) {
+    return false;
+  }
+  return nvs_get_blob(blob.handle, key, data, &stored) == ESP_OK;
+}
+
+/**
+ * @brief Writes and commits a blob
+ */
+bool nvsBlobSave(const NvsBlob& blob, const char* key, const void* data, size_t size) {
+  return blob.open && nvs_set_blob(blob.handle, key, data, size) == ESP_OK &&
+         nvs_commit(blob.handle) == ESP_OK;
+}
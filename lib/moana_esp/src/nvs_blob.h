@@ -0,0 +1,19 @@
+/*
+ * Fixed-size NVS blobs (pacing sets, usage counters), shared by the Arduino
+ * and ESP-IDF builds. Same on-flash layout as Preferences::putBytes(), so
+ * either firmware reads what the other stored. Handles are opened once at
+ * boot and kept open.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <nvs.h>
+
+struct NvsBlob {
+  nvs_handle_t handle;
+  bool open;
+};
+
+bool nvsBlobOpen(NvsBlob& blob, const char* nameSpace);
+bool nvsBlobLoad(const NvsBlob& blob, const char* key, void* data, size_t size);
+bool nvsBlobSave(const NvsBlob& blob, const char* key, const void* data, size_t size);
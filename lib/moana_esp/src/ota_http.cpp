@@ -0,0 +1,335 @@
+#include "ota_http.h"
+#include "console.h"
+#include "ota_session.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_http_server.h>
+#include <esp_ota_ops.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/version.h>
+
+const size_t OTA_CHUNK_BYTES = 1024;
+const int OTA_RECV_RETRIES = 5;    // Socket timeouts tolerated in a row
+
+static OtaHttpContext otaContext;
+static httpd_handle_t otaServer = NULL;
+
+// Image in progress; only the HTTP server task touches these
+static OtaSession session;
+static const esp_partition_t* otaPartition = NULL;
+static esp_ota_handle_t otaHandle = 0;
+static mbedtls_sha256_context otaSha;
+static char otaBuffer[OTA_CHUNK_BYTES];
+
+// Loop pause handshake: the server task bumps the epoch and waits until the
+// loop task has stopped everything for that epoch
+static volatile bool pauseRequested = false;
+static volatile uint32_t pauseEpoch = 0;
+static volatile uint32_t pausedEpoch = 0;
+
+// mbedtls 3 (ESP-IDF 5) dropped the _ret suffixes of mbedtls 2 (Arduino core 2.x)
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+static void shaStart() { mbedtls_sha256_starts(&otaSha, 0); }
+static void shaUpdate(const void* data, size_t length) { mbedtls_sha256_update(&otaSha, (const unsigned char*)data, length); }
+static void shaFinish(uint8_t* out) { mbedtls_sha256_finish(&otaSha, out); }
+#else
+static void shaStart() { mbedtls_sha256_starts_ret(&otaSha, 0); }
+static void shaUpdate(const void* data, size_t length) { mbedtls_sha256_update_ret(&otaSha, (const unsigned char*)data, length); }
+static void shaFinish(uint8_t* out) { mbedtls_sha256_finish_ret(&otaSha, out); }
+#endif
+
+/**
+ * @brief Pauses the loop task and waits until it has stopped all activity
+ */
+static void pauseLoop() {
+  pauseEpoch = pauseEpoch + 1;
+  pauseRequested = true;
+  while (pausedEpoch != pauseEpoch) {
+    vTaskDelay(pdMS_TO_TICKS(1));
+  }
+}
+
+static void resumeLoop() {
+  pauseRequested = false;
+}
+
+/**
+ * @brief Loop task side of the handshake: true while a request is being handled
+ */
+bool otaHttpPausesLoop(void (*stopActivity)()) {
+  if (!pauseRequested) {
+    return false;
+  }
+  if (pausedEpoch != pauseEpoch) {
+    stopActivity();
+    pausedEpoch = pauseEpoch;
+  }
+  return true;
+}
+
+/**
+ * @brief Drops the image in progress (the OTA slot is left unbootable)
+ */
+static void abortImage() {
+  if (session.active) {
+    esp_ota_abort(otaHandle);
+    mbedtls_sha256_free(&otaSha);
+    session.active = false;
+  }
+}
+
+/**
+ * @brief Counts a failed image and drops it
+ */
+static void failImage(const char* reason) {
+  consolePrintf("OTA Error: %s\n", reason);
+  abortImage();
+  otaContext.usage->stats.otaFailures++;
+  otaContext.flushUsageStats();
+}
+
+/**
+ * @brief Starts writing a new image into the next OTA slot
+ */
+static bool beginImage(uint32_t size, const uint8_t* sha256) {
+  abortImage();
+
+  // Record the attempt before flash writes start
+  otaContext.usage->stats.otaAttempts++;
+  otaContext.flushUsageStats();
+
+  // Erase sector by sector while writing; erasing the whole slot up front
+  // would stall this request for seconds
+  if (esp_ota_begin(otaPartition, OTA_WITH_SEQUENTIAL_WRITES, &otaHandle) != ESP_OK) {
+    consolePrintf("OTA Error: Begin Failed\n");
+    otaContext.usage->stats.otaFailures++;
+    otaContext.flushUsageStats();
+    return false;
+  }
+  mbedtls_sha256_init(&otaSha);
+  shaStart();
+
+  session.active = true;
+  session.size = size;
+  session.offset = 0;
+  memcpy(session.sha256, sha256, OTA_SHA256_BYTES);
+  consolePrintf("OTA Start (%lu bytes) - CRITICAL: Do not power off!\n", (unsigned long)size);
+  return true;
+}
+
+/**
+ * @brief Checks the hash of a complete image and makes it the boot partition
+ */
+static bool finishImage() {
+  uint8_t digest[OTA_SHA256_BYTES];
+  shaFinish(digest);
+  mbedtls_sha256_free(&otaSha);
+
+  if (memcmp(digest, session.sha256, OTA_SHA256_BYTES) != 0) {
+    esp_ota_abort(otaHandle);
+    session.active = false;
+    failImage("SHA-256 mismatch");
+    return false;
+  }
+
+  session.active = false;
+  // esp_ota_end() validates the app image itself
+  if (esp_ota_end(otaHandle) != ESP_OK || esp_ota_set_boot_partition(otaPartition) != ESP_OK) {
+    failImage("End Failed");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Replies with the offset the client should continue from
+ */
+static esp_err_t sendOffset(httpd_req_t* req, const char* status, uint32_t offset) {
+  char body[16];
+  snprintf(body, sizeof(body), "%lu\n", (unsigned long)offset);
+  httpd_resp_set_status(req, status);
+  return httpd_resp_sendstr(req, body);
+}
+
+/**
+ * @brief Checks X-OTA-Password, answering 401 if it is missing or wrong
+ */
+static bool authorize(httpd_req_t* req) {
+  char value[64];
+  if (httpd_req_get_hdr_value_str(req, "X-OTA-Password", value, sizeof(value)) == ESP_OK &&
+      otaPasswordMatches(value, otaContext.password)) {
+    return true;
+  }
+  consolePrintf("OTA request rejected: wrong or missing password\n");
+  httpd_resp_set_status(req, "401 Unauthorized");
+  httpd_resp_sendstr(req, "Need X-OTA-Password\n");
+  return false;
+}
+
+/**
+ * @brief Reads the X-SHA256 header, false if it is missing or malformed
+ */
+static bool readShaHeader(httpd_req_t* req, uint8_t* sha256) {
+  char value[OTA_SHA256_BYTES * 2 + 1];
+  return httpd_req_get_hdr_value_str(req, "X-SHA256", value, sizeof(value)) == ESP_OK &&
+         otaParseSha256(value, sha256);
+}
+
+/**
+ * @brief GET /update: where to continue sending the image given by X-Image-Size and X-SHA256
+ */
+static esp_err_t handleOffsetQuery(httpd_req_t* req) {
+  if (!authorize(req)) {
+    return ESP_FAIL;
+  }
+  uint8_t sha256[OTA_SHA256_BYTES];
+  char value[16];
+  if (!readShaHeader(req, sha256) ||
+      httpd_req_get_hdr_value_str(req, "X-Image-Size", value, sizeof(value)) != ESP_OK) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Need X-Image-Size and X-SHA256");
+    return ESP_FAIL;
+  }
+  uint32_t size = strtoul(value, NULL, 10);
+  return sendOffset(req, "200 OK", otaSessionResumeOffset(session, size, sha256));
+}
+
+/**
+ * @brief POST /update: writes one range of the image, boots it once complete and verified
+ */
+static esp_err_t handleUpload(httpd_req_t* req) {
+  if (!authorize(req)) {
+    return ESP_FAIL;
+  }
+  uint8_t sha256[OTA_SHA256_BYTES];
+  if (!readShaHeader(req, sha256)) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or bad X-SHA256");
+    return ESP_FAIL;
+  }
+
+  // Without Content-Range the body is the whole image
+  OtaRange range = {0, (uint32_t)req->content_len, (uint32_t)req->content_len};
+  char value[48];
+  if (httpd_req_get_hdr_value_str(req, "Content-Range", value, sizeof(value)) == ESP_OK &&
+      !otaParseContentRange(value, range)) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad Content-Range");
+    return ESP_FAIL;
+  }
+  if (range.end - range.start != req->content_len || range.total == 0 ||
+      !otaPartition || range.total > otaPartition->size) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad image size");
+    return ESP_FAIL;
+  }
+
+  pauseLoop();
+
+  switch (otaSessionCheck(session, range, sha256)) {
+    case OTA_CHUNK_OUT_OF_ORDER:
+      resumeLoop();
+      return sendOffset(req, "416 Range Not Satisfiable", otaSessionResumeOffset(session, range.total, sha256));
+    case OTA_CHUNK_NEW_IMAGE:
+      if (!beginImage(range.total, sha256)) {
+        resumeLoop();
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Update failed");
+        return ESP_FAIL;
+      }
+      break;
+    case OTA_CHUNK_CONTINUE:
+    default:
+      break;
+  }
+
+  int retries = 0;
+  int64_t lastPrint = esp_timer_get_time();
+  while (session.offset < range.end) {
+    size_t wanted = range.end - session.offset;
+    int length = httpd_req_recv(req, otaBuffer, wanted < sizeof(otaBuffer) ? wanted : sizeof(otaBuffer));
+    if (length == HTTPD_SOCK_ERR_TIMEOUT && ++retries <= OTA_RECV_RETRIES) {
+      continue;
+    }
+    if (length <= 0) {
+      // Connection lost: everything received so far stays written
+      consolePrintf("OTA interrupted at %lu of %lu bytes - resume to continue\n",
+                    (unsigned long)session.offset, (unsigned long)session.size);
+      resumeLoop();
+      return ESP_FAIL;
+    }
+    retries = 0;
+    if (esp_ota_write(otaHandle, otaBuffer, length) != ESP_OK) {
+      failImage("Flash write failed");
+      resumeLoop();
+      httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Update failed");
+      return ESP_FAIL;
+    }
+    shaUpdate(otaBuffer, length);
+    session.offset += length;
+
+    // Print progress less frequently to reduce overhead
+    if (esp_timer_get_time() - lastPrint > 1000000) {
+      consolePrintf("OTA Progress: %u%%\n", (unsigned)((uint64_t)session.offset * 100 / session.size));
+      lastPrint = esp_timer_get_time();
+    }
+  }
+
+  if (session.offset < session.size) {
+    resumeLoop();
+    return sendOffset(req, "200 OK", session.offset);
+  }
+
+  if (!finishImage()) {
+    resumeLoop(); // Back to normal operation; the upload can simply be retried
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Update failed");
+    return ESP_FAIL;
+  }
+
+  consolePrintf("OTA Complete! Rebooting...\n");
+  sendOffset(req, "200 OK", session.size);
+  vTaskDelay(pdMS_TO_TICKS(500));
+  esp_restart();
+  return ESP_OK;
+}
+
+/**
+ * @brief Starts the HTTP server on the soft AP (Wi-Fi must already be up)
+ */
+bool otaHttpStart(const OtaHttpContext& ctx) {
+  otaContext = ctx;
+  otaPartition = esp_ota_get_next_update_partition(NULL);
+
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.lru_purge_enable = true; // Reclaim sockets of clients that dropped off the AP
+
+  httpd_uri_t query = {};
+  query.uri = "/update";
+  query.method = HTTP_GET;
+  query.handler = handleOffsetQuery;
+
+  httpd_uri_t upload = {};
+  upload.uri = "/update";
+  upload.method = HTTP_POST;
+  upload.handler = handleUpload;
+
+  if (httpd_start(&otaServer, &config) != ESP_OK) {
+    otaServer = NULL;
+    return false;
+  }
+  httpd_register_uri_handler(otaServer, &query);
+  httpd_register_uri_handler(otaServer, &upload);
+  return true;
+}
+
+/**
+ * @brief Stops the HTTP server, dropping any image in progress
+ */
+void otaHttpStop() {
+  if (otaServer) {
+    httpd_stop(otaServer);
+    otaServer = NULL;
+  }
+  abortImage();
+}
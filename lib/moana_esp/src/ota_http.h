@@ -0,0 +1,35 @@
+/*
+ * Resumable firmware upload over HTTP on the Demo/OTA soft AP, shared by
+ * the Arduino and ESP-IDF builds (both ship esp_http_server).
+ *
+ *   GET  /update  X-Image-Size, X-SHA256 -> offset to continue from
+ *   POST /update  X-SHA256, Content-Range: bytes a-b/total, body = bytes a..b
+ *
+ * Both need X-OTA-Password; without it the answer is 401 and nothing is
+ * written.
+ * Every POST answers with the new offset. Bytes are written to the next OTA
+ * slot and hashed as they arrive; a dropped connection keeps everything up
+ * to the last byte received, so the client asks for the offset and sends
+ * the rest. The boot partition only changes when the whole image is in and
+ * its SHA-256 matches. A failed or mismatched image is dropped and counted,
+ * and the device keeps running. tools/ota_upload.py implements the client.
+ *
+ * Requests are served from the HTTP server task. While one is being
+ * handled the loop task is paused (otaHttpPausesLoop) so peripherals and
+ * usage counters keep a single owner.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "usage_stats.h"
+
+// What uploads act on; the callback does the NVS write
+struct OtaHttpContext {
+  UsageTracker* usage;
+  void (*flushUsageStats)();  // Stores usage->stats now
+  const char* password;       // Expected in X-OTA-Password
+};
+
+bool otaHttpStart(const OtaHttpContext& ctx);
+void otaHttpStop();
+bool otaHttpPausesLoop(void (*stopActivity)());
@@ -0,0 +1,116 @@
+#include "persistence.h"
+#include "console.h"
+#include "ir_clock.h"
+
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+
+// Sweep position across resets (see sweep_resume.h)
+RTC_NOINIT_ATTR SweepResumeState rtcSweepState;
+
+/**
+ * @brief Loads both pacing sets from NVS (once, at boot)
+ */
+void loadPacing(IRSweep& sweep, NvsBlob& prefs) {
+  irSweepInit(sweep);
+
+  // Kept open for the lifetime of the firmware so "save" does not reopen NVS
+  nvsBlobOpen(prefs, "pacing");
+
+  if (nvsBlobLoad(prefs, "sets", sweep.pacingSets, sizeof(sweep.pacingSets))) {
+    for (int i = 0; i < 2; i++) {
+      if (!isValidPacing(sweep.pacingSets[i])) {
+        consolePrintf("Stored IR pacing set invalid, using defaults\n");
+        sweep.pacingSets[i] = DEFAULT_PACING;
+      }
+    }
+    consolePrintf("IR pacing loaded from NVS\n");
+  } else {
+    consolePrintf("IR pacing: using defaults\n");
+  }
+
+  irSweepApplyOrder(sweep);
+}
+
+/**
+ * @brief Stores both pacing sets in NVS ("save" command)
+ *
+ * The caller holds irClockLock(). It is released for the flash write, which
+ * stalls for milliseconds, so the frame clock keeps sending meanwhile.
+ */
+bool savePacing(const IRSweep& sweep, const NvsBlob& prefs) {
+  IRPacing sets[2];
+  memcpy(sets, sweep.pacingSets, sizeof(sets));
+  irClockUnlock();
+  bool saved = nvsBlobSave(prefs, "sets", sets, sizeof(sets));
+  irClockLock();
+  return saved;
+}
+
+/**
+ * @brief Restores the sweep position from RTC memory if it is valid
+ */
+void loadSweepResumeState(IRSweep& sweep) {
+  consolePrintf("Reset reason: %d\n", (int)esp_reset_reason());
+
+  switch (sweepStateRestore(rtcSweepState, sweep)) {
+    case SWEEP_RESUME_OK:
+      consolePrintf("Resuming IR sweep at position %d of %d\n", sweep.position, numCommands);
+      break;
+    case SWEEP_RESUME_ORDER_CHANGED:
+      consolePrintf("IR sweep order changed since last run, starting from the top\n");
+      break;
+    case SWEEP_RESUME_INVALID:
+    default:
+      consolePrintf("No valid IR sweep state in RTC memory, starting from the top\n");
+      break;
+  }
+
+  saveSweepResumeState(sweep);
+}
+
+/**
+ * @brief Writes the current sweep position to RTC memory (called after every frame)
+ */
+void saveSweepResumeState(const IRSweep& sweep) {
+  sweepStateCapture(sweep, rtcSweepState);
+}
+
+/**
+ * @brief Loads the lifetime counters from NVS and counts this boot
+ */
+void loadUsageStats(UsageTracker& usage, NvsBlob& prefs, uint32_t now) {
+  memset(&usage, 0, sizeof(usage));
+
+  // Kept open for the lifetime of the firmware so flushes do not reopen NVS
+  nvsBlobOpen(prefs, "stats");
+  if (!nvsBlobLoad(prefs, "lifetime", &usage.stats, sizeof(usage.stats))) {
+    consolePrintf("No usage statistics stored, starting fresh\n");
+  }
+
+  usageTrackerStart(usage, now);
+}
+
+/**
+ * @brief Writes the counters to NVS as a single blob
+ *
+ * The caller holds irClockLock(). A snapshot is written with the lock
+ * released; bursts counted during the write keep the tracker dirty.
+ */
+bool flushUsageStats(UsageTracker& usage, const NvsBlob& prefs, uint32_t now) {
+  UsageStats snapshot = usage.stats;
+  irClockUnlock();
+  bool saved = nvsBlobSave(prefs, "lifetime", &snapshot, sizeof(snapshot));
+  if (!saved) {
+    consolePrintf("Failed to write usage statistics!\n");
+  }
+  irClockLock();
+  if (!saved) {
+    return false;
+  }
+  bool changed = memcmp(&snapshot, &usage.stats, sizeof(snapshot)) != 0;
+  usageTrackerFlushed(usage, now);
+  usage.dirty = changed;
+  return true;
+}
@@ -0,0 +1,21 @@
+/*
+ * Pacing sets, usage counters (NVS) and the sweep resume record (RTC
+ * memory), shared by the Arduino and ESP-IDF builds so both use the same
+ * namespaces, keys and layouts. savePacing() and flushUsageStats() are
+ * called with irClockLock() held and release it for the flash write.
+ * Messages go through consolePrintf().
+ */
+#pragma once
+
+#include <stdint.h>
+#include "ir_sweep.h"
+#include "nvs_blob.h"
+#include "sweep_resume.h"
+#include "usage_stats.h"
+
+void loadPacing(IRSweep& sweep, NvsBlob& prefs);
+bool savePacing(const IRSweep& sweep, const NvsBlob& prefs);
+void loadSweepResumeState(IRSweep& sweep);
+void saveSweepResumeState(const IRSweep& sweep);
+void loadUsageStats(UsageTracker& usage, NvsBlob& prefs, uint32_t now);
+bool flushUsageStats(UsageTracker& usage, const NvsBlob& prefs, uint32_t now);
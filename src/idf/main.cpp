@@ -0,0 +1,769 @@
+/*
+ * Firmware for the ESP32-C3 IR Blaster Toy - plain ESP-IDF build
+ *
+ * Same behaviour as the Arduino firmware in src/main.cpp, built without the
+ * Arduino layer (env:esp32-c3-idf) so boot time and image size of the two
+ * builds can be compared directly. Both print "Boot time: N ms" at the end
+ * of setup. The state machine, code tables, encoder and sweep scheduler come
+ * from lib/moana_core; the IR transmit path, RMT/NVS drivers and pin map
+ * from lib/moana_esp.
+ *
+ * Differences in mechanism, not behaviour:
+ * - "Magical Glow" runs on the LEDC peripheral instead of a timer ISR
+ *   calling digitalWrite() at 5 kHz.
+ * - Button presses arrive from a GPIO interrupt instead of loop polling.
+ * - The soft AP is brought up through esp_wifi instead of WiFi.softAP();
+ *   both builds serve the same resumable upload endpoint (ota_http.h).
+ * - BLE spam uses the Bluedroid GAP API directly.
+ */
+
+// ######################################################################
+// ##                       LIBRARY INCLUSIONS                         ##
+// ######################################################################
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <driver/gpio.h>
+#include <driver/ledc.h>
+#include <driver/rmt.h>
+#include <esp_attr.h>
+#include <esp_bt.h>
+#include <esp_bt_main.h>
+#include <esp_event.h>
+#include <esp_gap_ble_api.h>
+#include <esp_netif.h>
+#include <esp_ota_ops.h>
+#include <esp_random.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <nvs_flash.h>
+#ifdef BATTERY_SENSE_PIN
+#include <esp_adc/adc_cali.h>
+#include <esp_adc/adc_cali_scheme.h>
+#include <esp_adc/adc_oneshot.h>
+#endif
+
+// Shared with the Arduino build
+#include "board.h"
+#include "ble_payloads.h"
+#include "console.h"
+#include "glow.h"
+#include "ir_clock.h"
+#include "ir_sweep.h"
+#include "ir_transmit.h"
+#include "nvs_blob.h"
+#include "ota_http.h"
+#include "persistence.h"
+#include "state_machine.h"
+#include "supply_monitor.h"
+#include "usage_stats.h"
+
+// ######################################################################
+// ##                       IR SWEEP & DISPATCH                        ##
+// ######################################################################
+IRSweep sweep;
+NvsBlob pacingPrefs;
+const uint32_t LOOP_DELAY_MS = 10; // IR frames run on their own clock (ir_transmit.h)
+
+// ######################################################################
+// ##                  BLUETOOTH SPOOFING CONFIGURATION                ##
+// ######################################################################
+
+// Bluetooth maximum transmit power for ESP32-C3
+#if defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C2) || defined(CONFIG_IDF_TARGET_ESP32S3)
+#define MAX_TX_POWER ESP_PWR_LVL_P21  // ESP32C3 ESP32C2 ESP32S3
+#elif defined(CONFIG_IDF_TARGET_ESP32H2) || defined(CONFIG_IDF_TARGET_ESP32C6)
+#define MAX_TX_POWER ESP_PWR_LVL_P20  // ESP32H2 ESP32C6
+#else
+#define MAX_TX_POWER ESP_PWR_LVL_P9   // Default
+#endif
+
+const uint32_t BLE_SPOOF_INTERVAL_MS = 30; // Very aggressive timing for maximum Samsung/Apple spam
+
+// Same advertising parameters BLEAdvertising uses in the Arduino build
+esp_ble_adv_params_t bleAdvParams = {};
+bool bleInitialized = false;
+bool bleAdvertising = false;
+uint32_t lastBLESpoofTime = 0;
+
+// ######################################################################
+// ##                       STATE MACHINE VARIABLES                    ##
+// ######################################################################
+StateMachine machine = {STATE_IDLE, 0, 0};
+bool isOtaMode = false;
+bool breathingActive = false;
+uint32_t breathingStartTime = 0;
+
+// Button edges from the GPIO interrupt, debounced in the loop task.
+// The queue is statically allocated like every other loop buffer.
+struct ButtonEdge {
+  uint32_t timeMs;
+  uint8_t level;
+};
+
+const int BUTTON_QUEUE_LENGTH = 16;
+QueueHandle_t buttonQueue = NULL;
+StaticQueue_t buttonQueueState;
+uint8_t buttonQueueStorage[BUTTON_QUEUE_LENGTH * sizeof(ButtonEdge)];
+
+const ledc_channel_t GLOW_CHANNELS[] = {(ledc_channel_t)LED1_CHAN, (ledc_channel_t)LED2_CHAN, (ledc_channel_t)LED3_CHAN};
+const int GLOW_PINS[] = {LED1_PIN, LED2_PIN, LED3_PIN};
+const int NUM_GLOW_LEDS = sizeof(GLOW_PINS) / sizeof(GLOW_PINS[0]);
+
+// ######################################################################
+// ##                     LIFETIME USAGE STATISTICS                    ##
+// ######################################################################
+UsageTracker usage;
+NvsBlob statsPrefs;
+
+// ######################################################################
+// ##                      BATTERY SUPPLY MONITOR                      ##
+// ######################################################################
+
+// Sampled between IR frames when battery sense is fitted (see board.h)
+SupplyMonitor supply;
+
+#ifdef BATTERY_SENSE_PIN
+adc_oneshot_unit_handle_t batteryAdc = NULL;
+adc_cali_handle_t batteryCali = NULL;
+adc_channel_t batteryChannel;
+#endif
+
+// ######################################################################
+// ##                       FORWARD DECLARATIONS                       ##
+// ######################################################################
+void setup();
+void loop();
+uint32_t millisNow();
+void setupGpio();
+void setupGlow();
+void setGlowBrightness(uint8_t brightness);
+void handleMagicalGlow(uint32_t now);
+void IRAM_ATTR onButtonEdge(void* arg);
+void handleButtonPress(uint32_t now);
+void updateStateMachine(uint32_t now);
+void stopActivity();
+void setupBLE();
+void handleBLESpoofing(uint32_t now);
+void cycleBLEDevice();
+void stopBLEAdvertising();
+void printFlashInfo();
+void setupOtaServer();
+void stopOtaServer();
+bool savePacing();
+void flushUsageStats();
+void otaFlushUsageStats();
+void setupSupplyMonitor();
+uint16_t readBatteryMv();
+void handleSerialCommands();
+
+// ######################################################################
+// ##                            ENTRY POINT                           ##
+// ######################################################################
+extern "C" void app_main() {
+  setup();
+  while (true) {
+    loop();
+  }
+}
+
+// ######################################################################
+// ##                          SETUP FUNCTION                          ##
+// ######################################################################
+void setup() {
+  printf("\nBooting up (ESP-IDF)...\n");
+
+  // NVS holds the pacing sets and usage counters (Arduino does this in initArduino())
+  esp_err_t err = nvs_flash_init();
+  if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+    nvs_flash_erase();
+    nvs_flash_init();
+  }
+
+  // The task watchdog is started by ESP-IDF (10 s, sdkconfig.defaults)
+  esp_task_wdt_add(NULL);
+  printf("Watchdog timer configured (10s timeout)\n");
+
+  // Non-blocking console input for the serial commands
+  fcntl(STDIN_FILENO, F_SETFL, O_NONBLOCK);
+
+  printFlashInfo();
+
+  // Same NVS/RTC state as the Arduino build
+  loadPacing(sweep, pacingPrefs);
+  loadSweepResumeState(sweep);
+  loadUsageStats(usage, statsPrefs, millisNow());
+
+  setupGpio();
+  static const IrTransmitContext irContext = {&sweep, &machine, &supply, &usage, readBatteryMv};
+  irTransmitInstall(irContext);
+  setupSupplyMonitor();
+  setupGlow();
+
+  // Turn on debug LED to show device is running
+  gpio_set_level((gpio_num_t)DEBUG_LED_PIN, 1);
+  printf("Debug LED ON - Device running continuously\n");
+
+  esp_task_wdt_reset();
+
+  // Check mode switch
+  isOtaMode = (gpio_get_level((gpio_num_t)SWITCH_PIN) == 1);
+  if (isOtaMode) {
+    printf("Mode: Demo / OTA\n");
+    setupOtaServer();
+  } else {
+    printf("Mode: Play\n");
+  }
+
+  esp_task_wdt_reset();
+
+  // Initialize Bluetooth for device spoofing
+  setupBLE();
+
+  printf("Initialization complete. Entering main loop...\n");
+
+  // Compare with the same line from the Arduino build (env:esp32-c3-devkitm-1)
+  printf("Boot time: %lu ms\n", (unsigned long)(esp_timer_get_time() / 1000));
+}
+
+// ######################################################################
+// ##                          LOOP FUNCTION                           ##
+// ######################################################################
+void loop() {
+  static uint32_t lastDebugPrint = 0;
+  uint32_t now = millisNow();
+
+  esp_task_wdt_reset();
+
+  // A firmware upload request owns the device while it is being handled
+  if (otaHttpPausesLoop(stopActivity)) {
+    vTaskDelay(pdMS_TO_TICKS(LOOP_DELAY_MS));
+    return;
+  }
+
+  // Accumulate usage time and flush counters to NVS when due
+  irClockLock(); // Bursts are counted by the frame clock
+  if (usageTrackerService(usage, machine.state, now)) {
+    flushUsageStats();
+  }
+  irClockUnlock();
+
+  // Messages from the IR frame clock and the battery sampling
+  irTransmitService();
+
+  // Debug output every 5 seconds to show the device is running
+  if (now - lastDebugPrint >= 5000) {
+    printf("Loop running, State: %d, Button: %s, Switch: %s, Mode: %s, BLE: %s",
+           (int)machine.state,
+           gpio_get_level((gpio_num_t)BUTTON_PIN) ? "HIGH" : "LOW",
+           gpio_get_level((gpio_num_t)SWITCH_PIN) ? "HIGH" : "LOW",
+           isOtaMode ? "OTA" : "Play",
+           (machine.state != STATE_IDLE && bleInitialized) ? "ACTIVE (Apple/Samsung/Android Spam)" : "IDLE");
+    irTransmitPrintStatus();
+    printf(", Free heap: %u bytes\n", (unsigned)esp_get_free_heap_size());
+    lastDebugPrint = now;
+
+    // Visual feedback: quick double blink in OTA mode, single blink in Play mode
+    gpio_set_level((gpio_num_t)DEBUG_LED_PIN, 0);
+    vTaskDelay(pdMS_TO_TICKS(isOtaMode ? 50 : 100));
+    gpio_set_level((gpio_num_t)DEBUG_LED_PIN, 1);
+    if (isOtaMode) {
+      vTaskDelay(pdMS_TO_TICKS(50));
+      gpio_set_level((gpio_num_t)DEBUG_LED_PIN, 0);
+      vTaskDelay(pdMS_TO_TICKS(50));
+      gpio_set_level((gpio_num_t)DEBUG_LED_PIN, 1);
+    }
+  }
+
+  // Serial commands (pacing, A/B benchmark)
+  handleSerialCommands();
+
+  handleButtonPress(now);
+  updateStateMachine(now);
+
+  bool isActive = stateMachineActive(machine);
+  if (isActive) {
+    handleMagicalGlow(now);
+    handleBLESpoofing(now);
+  }
+
+  // IR frames are started by the frame clock, so loop() keeps a fixed pace
+  vTaskDelay(pdMS_TO_TICKS(LOOP_DELAY_MS));
+}
+
+// ######################################################################
+// ##                       HELPER FUNCTIONS                           ##
+// ######################################################################
+
+/**
+ * @brief Milliseconds since boot (what millis() is in the Arduino build)
+ */
+uint32_t millisNow() {
+  return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/**
+ * @brief Configures the switch, debug LED and the button interrupt
+ */
+void setupGpio() {
+  // Switch with external pulldown
+  gpio_config_t input = {};
+  input.pin_bit_mask = 1ULL << SWITCH_PIN;
+  input.mode = GPIO_MODE_INPUT;
+  gpio_config(&input);
+
+  // Active-high button with external pulldown; both edges so release
+  // bounce can be told from a new press
+  gpio_config_t button = {};
+  button.pin_bit_mask = 1ULL << BUTTON_PIN;
+  button.mode = GPIO_MODE_INPUT;
+  button.intr_type = GPIO_INTR_ANYEDGE;
+  gpio_config(&button);
+
+  buttonQueue = xQueueCreateStatic(BUTTON_QUEUE_LENGTH, sizeof(ButtonEdge), buttonQueueStorage, &buttonQueueState);
+  gpio_install_isr_service(0);
+  gpio_isr_handler_add((gpio_num_t)BUTTON_PIN, onButtonEdge, NULL);
+
+  gpio_config_t output = {};
+  output.pin_bit_mask = 1ULL << DEBUG_LED_PIN;
+  output.mode = GPIO_MODE_OUTPUT;
+  gpio_config(&output);
+}
+
+/**
+ * @brief Sets up the three glow LEDs on LEDC, inverted for the active-low LEDs
+ */
+void setupGlow() {
+  ledc_timer_config_t timerConfig = {};
+  timerConfig.speed_mode = LEDC_LOW_SPEED_MODE;
+  timerConfig.duty_resolution = (ledc_timer_bit_t)PWM_RESOLUTION;
+  timerConfig.timer_num = LEDC_TIMER_0;
+  timerConfig.freq_hz = PWM_FREQ;
+  timerConfig.clk_cfg = LEDC_AUTO_CLK;
+  ledc_timer_config(&timerConfig);
+
+  for (int i = 0; i < NUM_GLOW_LEDS; i++) {
+    ledc_channel_config_t channel = {};
+    channel.gpio_num = GLOW_PINS[i];
+    channel.speed_mode = LEDC_LOW_SPEED_MODE;
+    channel.channel = GLOW_CHANNELS[i];
+    channel.timer_sel = LEDC_TIMER_0;
+    channel.duty = 0;
+    channel.flags.output_invert = 1; // Duty 0 drives the pin HIGH (off)
+    ledc_channel_config(&channel);
+  }
+  printf("LEDC glow setup complete - %d Hz PWM\n", PWM_FREQ);
+}
+
+/**
+ * @brief Sets all glow LEDs to a brightness of 0-100
+ */
+void setGlowBrightness(uint8_t brightness) {
+  uint32_t duty = (uint32_t)brightness * ((1 << PWM_RESOLUTION) - 1) / 100;
+  for (int i = 0; i < NUM_GLOW_LEDS; i++) {
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, GLOW_CHANNELS[i], duty);
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, GLOW_CHANNELS[i]);
+  }
+}
+
+/**
+ * @brief Updates the breathing brightness (called from main loop)
+ */
+void handleMagicalGlow(uint32_t now) {
+  static uint32_t lastUpdate = 0;
+
+  if (now - lastUpdate >= GLOW_UPDATE_MS) {
+    lastUpdate = now;
+    setGlowBrightness(breathingActive ? glowBrightness(now - breathingStartTime, now) : 0);
+  }
+}
+
+/**
+ * @brief Button interrupt: queues the edge for the loop task
+ */
+void IRAM_ATTR onButtonEdge(void* arg) {
+  ButtonEdge edge;
+  edge.timeMs = (uint32_t)(esp_timer_get_time() / 1000);
+  edge.level = gpio_get_level((gpio_num_t)BUTTON_PIN);
+  BaseType_t woken = pdFALSE;
+  xQueueSendFromISR(buttonQueue, &edge, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+/**
+ * @brief Debounces queued button edges and handles presses
+ */
+void handleButtonPress(uint32_t now) {
+  static uint32_t lastEdgeTime = 0;
+  static uint32_t otaModeExitStartTime = 0;
+  static bool otaExitInProgress = false;
+
+  ButtonEdge edge;
+  while (xQueueReceive(buttonQueue, &edge, 0) == pdTRUE) {
+    // Contact bounce: an edge only counts after a quiet debounce period
+    bool settled = edge.timeMs - lastEdgeTime >= BUTTON_DEBOUNCE_MS;
+    lastEdgeTime = edge.timeMs;
+    if (!settled || !edge.level) {
+      continue;
+    }
+
+    if (isOtaMode) {
+      // In OTA mode: Start OTA exit timer OR start normal operation
+      otaModeExitStartTime = edge.timeMs;
+      otaExitInProgress = true;
+      printf("Button pressed in OTA mode - starting timer for mode exit or normal operation\n");
+    }
+
+    if (stateMachinePress(machine, edge.timeMs) == STATE_EVENT_ACTIVATED) {
+      printf("Button press detected! Starting operation immediately...\n");
+      breathingActive = true;
+      breathingStartTime = edge.timeMs;
+      irTransmitBegin();
+
+      // Start BLE spam when device becomes active
+      if (bleInitialized) {
+        lastBLESpoofTime = now;
+        cycleBLEDevice();
+        printf("Apple/Samsung/Android BLE spam activated\n");
+      }
+    } else {
+      printf("Button press detected but not in idle state\n");
+    }
+  }
+
+  if (!otaExitInProgress) {
+    return;
+  }
+  if (!gpio_get_level((gpio_num_t)BUTTON_PIN)) {
+    otaExitInProgress = false;
+    printf("Button released - OTA exit cancelled, normal operation continues\n");
+  } else if (now - otaModeExitStartTime >= 5000) {
+    // Button held for 5+ seconds - exit OTA mode
+    printf("Button held for 5+ seconds in OTA mode - EXITING OTA MODE!\n");
+    stopOtaServer();
+    isOtaMode = false;
+    stopActivity();
+    otaExitInProgress = false;
+    machine.lastButtonPressTime = now;
+    printf("Successfully switched to Play Mode!\n");
+  }
+}
+
+/**
+ * @brief Updates the state machine based on current state and timing
+ */
+void updateStateMachine(uint32_t now) {
+  DeviceState previous = machine.state;
+
+  switch (stateMachineUpdate(machine, gpio_get_level((gpio_num_t)BUTTON_PIN), now)) {
+    case STATE_EVENT_LONG_PRESS:
+      printf("Long press threshold reached! Continuing until button release...\n");
+      usageTrackerRecordPress(usage, true);
+      break;
+
+    case STATE_EVENT_SHORT_PRESS:
+      printf("Short press completed! Will run for 10 seconds total...\n");
+      usageTrackerRecordPress(usage, false);
+      break;
+
+    case STATE_EVENT_FINISHED:
+      printf(previous == STATE_RUNNING_SHORT ? "Short press timer expired. Returning to idle.\n"
+                                             : "Button released. Returning to idle.\n");
+      stopActivity();
+      irClockLock();
+      if (usageTrackerActivationEndDue(usage, now)) {
+        flushUsageStats();
+      }
+      irClockUnlock();
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Returns to idle: glow off, BLE advertising stopped
+ */
+void stopActivity() {
+  irClockLock(); // No frame in flight afterwards; the clock stops by itself
+  machine.state = STATE_IDLE;
+  irClockUnlock();
+  breathingActive = false;
+  setGlowBrightness(0);
+  stopBLEAdvertising();
+}
+
+/**
+ * @brief Starts the supply monitor if battery sense is fitted
+ */
+void setupSupplyMonitor() {
+#ifdef BATTERY_SENSE_PIN
+  adc_unit_t unit;
+  adc_oneshot_unit_init_cfg_t unitConfig = {};
+  adc_oneshot_chan_cfg_t channelConfig = {};
+  channelConfig.atten = ADC_ATTEN_DB_12; // Up to ~2.5 V at the pin
+  channelConfig.bitwidth = ADC_BITWIDTH_DEFAULT;
+  adc_cali_curve_fitting_config_t caliConfig = {};
+
+  bool ready = adc_oneshot_io_to_channel(BATTERY_SENSE_PIN, &unit, &batteryChannel) == ESP_OK;
+  unitConfig.unit_id = unit;
+  caliConfig.unit_id = unit;
+  caliConfig.atten = channelConfig.atten;
+  caliConfig.bitwidth = channelConfig.bitwidth;
+  ready = ready && adc_oneshot_new_unit(&unitConfig, &batteryAdc) == ESP_OK &&
+          adc_oneshot_config_channel(batteryAdc, batteryChannel, &channelConfig) == ESP_OK &&
+          adc_cali_create_scheme_curve_fitting(&caliConfig, &batteryCali) == ESP_OK;
+  if (!ready) {
+    supplyMonitorInit(supply, false, false);
+    printf("Battery sense ADC setup failed - IR drive is not throttled\n");
+    return;
+  }
+
+  supplyMonitorInit(supply, true, esp_reset_reason() == ESP_RST_BROWNOUT);
+  printf("Battery: %u mV at rest, IR drive level %u\n", (unsigned)readBatteryMv(), (unsigned)supply.level);
+#else
+  supplyMonitorInit(supply, false, false);
+  printf("Battery sense not fitted - IR drive is not throttled\n");
+#endif
+}
+
+/**
+ * @brief Battery voltage in mV, averaged over BATTERY_SAMPLES reads
+ */
+uint16_t readBatteryMv() {
+#ifdef BATTERY_SENSE_PIN
+  int sum = 0;
+  for (int i = 0; i < BATTERY_SAMPLES; i++) {
+    int raw = 0;
+    int mv = 0;
+    adc_oneshot_read(batteryAdc, batteryChannel, &raw);
+    adc_cali_raw_to_voltage(batteryCali, raw, &mv);
+    sum += mv;
+  }
+  return sum * BATTERY_DIVIDER_RATIO / BATTERY_SAMPLES;
+#else
+  return 0;
+#endif
+}
+
+// ######################################################################
+// ##                    BLUETOOTH SPOOFING FUNCTIONS                  ##
+// ######################################################################
+
+/**
+ * @brief Brings up the BLE controller and Bluedroid for advertising only
+ */
+void setupBLE() {
+  printf("Initializing BLE for Apple/Samsung/Android spam...\n");
+
+  esp_bt_controller_config_t config = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+  if (esp_bt_controller_init(&config) != ESP_OK ||
+      esp_bt_controller_enable(ESP_BT_MODE_BLE) != ESP_OK ||
+      esp_bluedroid_init() != ESP_OK ||
+      esp_bluedroid_enable() != ESP_OK) {
+    printf("BLE initialization failed\n");
+    return;
+  }
+
+  esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, MAX_TX_POWER);
+
+  bleAdvParams.adv_int_min = 0x20;
+  bleAdvParams.adv_int_max = 0x40;
+  bleAdvParams.adv_type = ADV_TYPE_IND;
+  bleAdvParams.own_addr_type = BLE_ADDR_TYPE_RANDOM;
+  bleAdvParams.channel_map = ADV_CHNL_ALL;
+  bleAdvParams.adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+
+  bleInitialized = true;
+  printf("BLE initialized successfully (spam will start on button press)\n");
+}
+
+/**
+ * @brief Advertises the next random payload from a random address
+ */
+void cycleBLEDevice() {
+  static const esp_ble_adv_type_t ADV_TYPES[] = {ADV_TYPE_IND, ADV_TYPE_SCAN_IND, ADV_TYPE_NONCONN_IND};
+
+  if (!bleInitialized) {
+    return;
+  }
+
+  stopBLEAdvertising();
+
+  // Fake random MAC address; the first 4 bits need to be high for a static random address
+  esp_bd_addr_t address;
+  for (int i = 0; i < 6; i++) {
+    address[i] = esp_random() & 0xFF;
+  }
+  address[0] |= 0xF0;
+  esp_ble_gap_set_rand_addr(address);
+
+  const BLEDeviceFamily& family = BLE_DEVICE_FAMILIES[esp_random() % NUM_BLE_DEVICE_FAMILIES];
+  int index = esp_random() % family.count;
+  const uint8_t* payload = family.packets + index * family.stride;
+
+  // The GAP layer copies the payload, so it is sent straight from flash
+  esp_ble_gap_config_adv_data_raw(const_cast<uint8_t*>(payload), family.length);
+  bleAdvParams.adv_type = ADV_TYPES[esp_random() % 3];
+  bleAdvertising = (esp_ble_gap_start_advertising(&bleAdvParams) == ESP_OK);
+
+  printf("BLE SPAM: %s %d\n", family.name, index);
+
+  // Random signal strength for better stealth
+  uint32_t randVal = esp_random() % 100;
+  int reduction = randVal < 70 ? 0 : randVal < 85 ? 1 : randVal < 95 ? 2 : randVal < 99 ? 3 : 4;
+  esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, (esp_power_level_t)(MAX_TX_POWER - reduction));
+}
+
+/**
+ * @brief Stops advertising if it is running
+ */
+void stopBLEAdvertising() {
+  if (bleAdvertising) {
+    esp_ble_gap_stop_advertising();
+    bleAdvertising = false;
+  }
+}
+
+/**
+ * @brief Handle BLE device spoofing timing and cycling
+ */
+void handleBLESpoofing(uint32_t now) {
+  if (!bleInitialized || machine.state == STATE_IDLE) {
+    return;
+  }
+  if (now - lastBLESpoofTime >= BLE_SPOOF_INTERVAL_MS) {
+    cycleBLEDevice();
+    lastBLESpoofTime = now;
+  }
+}
+
+// ######################################################################
+// ##                       OTA OVER HTTP FUNCTIONS                    ##
+// ######################################################################
+
+/**
+ * @brief Print partition information
+ */
+void printFlashInfo() {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  const esp_partition_t* update = esp_ota_get_next_update_partition(NULL);
+
+  printf("\n=== FLASH MEMORY ANALYSIS ===\n");
+  if (running) {
+    printf("Running partition: %s (size: %u bytes)\n", running->label, (unsigned)running->size);
+  }
+  if (update) {
+    printf("Update partition: %s (size: %u bytes)\n", update->label, (unsigned)update->size);
+  }
+  printf("=============================\n\n");
+}
+
+/**
+ * @brief Starts the soft AP and the HTTP server taking firmware uploads
+ */
+void setupOtaServer() {
+  printf("Setting up OTA Access Point...\n");
+
+  esp_netif_init();
+  esp_event_loop_create_default();
+  esp_netif_create_default_wifi_ap();
+
+  wifi_init_config_t init = WIFI_INIT_CONFIG_DEFAULT();
+  wifi_config_t ap = {};
+  strncpy((char*)ap.ap.ssid, OTA_SSID, sizeof(ap.ap.ssid));
+  ap.ap.ssid_len = strlen(OTA_SSID);
+  strncpy((char*)ap.ap.password, OTA_PASSWORD, sizeof(ap.ap.password));
+  ap.ap.channel = 1;
+  ap.ap.max_connection = 1; // One connection for stability, as in the Arduino build
+  ap.ap.authmode = WIFI_AUTH_WPA2_PSK;
+
+  if (esp_wifi_init(&init) != ESP_OK ||
+      esp_wifi_set_mode(WIFI_MODE_AP) != ESP_OK ||
+      esp_wifi_set_config(WIFI_IF_AP, &ap) != ESP_OK ||
+      esp_wifi_start() != ESP_OK) {
+    printf("Failed to start WiFi AP! Continuing without OTA...\n");
+    return;
+  }
+
+  static const OtaHttpContext context = {&usage, otaFlushUsageStats, OTA_PASSWORD};
+  if (!otaHttpStart(context)) {
+    printf("Failed to start the OTA HTTP server!\n");
+    return;
+  }
+
+  printf("OTA Ready. Connect to WiFi AP: %s\n", OTA_SSID);
+  printf("Password: %s\n", OTA_PASSWORD);
+  printf("Upload via: python3 tools/ota_upload.py firmware.bin\n");
+}
+
+/**
+ * @brief Stops the HTTP server and the soft AP (leaving Demo/OTA mode)
+ */
+void stopOtaServer() {
+  otaHttpStop();
+  esp_wifi_stop();
+}
+
+// ######################################################################
+// ##                     SERIAL COMMAND INTERFACE                     ##
+// ######################################################################
+
+/**
+ * @brief Stores both pacing sets in NVS ("save" command; caller holds irClockLock())
+ */
+bool savePacing() {
+  return savePacing(sweep, pacingPrefs);
+}
+
+/**
+ * @brief Writes the counters to NVS now (caller holds irClockLock())
+ */
+void flushUsageStats() {
+  flushUsageStats(usage, statsPrefs, millisNow());
+}
+
+/**
+ * @brief Writes the counters to NVS from the OTA HTTP server task
+ */
+void otaFlushUsageStats() {
+  irClockLock();
+  flushUsageStats();
+  irClockUnlock();
+}
+
+/**
+ * @brief Console output for the shared command interface (console.h)
+ */
+void consolePrintf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+}
+
+/**
+ * @brief Collects console input into a static line buffer and runs complete lines
+ */
+void handleSerialCommands() {
+  static ConsoleLine line;
+  static const ConsoleContext context = {&sweep, &usage, &supply, savePacing, flushUsageStats,
+                                         irClockLock, irClockUnlock};
+
+  char c;
+  while (read(STDIN_FILENO, &c, 1) == 1) {
+    if (consoleLineFeed(line, c)) {
+      consoleExecute(line.text, context); // Takes the clock lock itself, prints outside it
+    }
+  }
+}
@@ -11,18 +11,19 @@
  * - "Magical Glow" LED animation using simple blinking.
  * - Cyclical IR blasting of a comprehensive list of TV power-off codes.
  * - OTA firmware updates in Demo Mode over a custom Wi-Fi AP.
+ *
+ * The state machine, code tables, encoder and sweep scheduler live in
+ * lib/moana_core; the IR transmit path, RMT/NVS drivers and pin map in
+ * lib/moana_esp. Both are shared with the plain ESP-IDF build in src/idf
+ * (env:esp32-c3-idf).
  */
 
 // ######################################################################
 // ##                       LIBRARY INCLUSIONS                         ##
 // ######################################################################
 #include <Arduino.h>
-#include <IRremoteESP8266.h>
-#include <IRsend.h>
+#include <driver/rmt.h>
 #include <WiFi.h>
-#include <ESPmDNS.h>
-#include <WiFiUdp.h>
-#include <ArduinoOTA.h>
 #include <esp_task_wdt.h>
 #include <BLEDevice.h>
 #include <BLEAdvertising.h>
@@ -30,88 +31,38 @@
 #include <BLEServer.h>
 #include <esp_ota_ops.h>
 #include <esp_partition.h>
+#include <esp_system.h>
+#include <stdarg.h>
 
-// ######################################################################
-// ##                       HARDWARE DEFINITIONS                       ##
-// ######################################################################
-
-// --- Pin Definitions for ESP32-C3 Super Mini ---
-// Available GPIO pins: 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 20, 21
-// Avoid: GPIO 11-17 (SPI Flash), GPIO 18-19 (USB), GPIO 12-13 (SPI)
-const int IR_LED_PIN = 2;     // GPIO 2 - Safe for output, commonly used for LEDs
-const int LED1_PIN   = 6;     // GPIO 6 - Safe for output
-const int LED2_PIN   = 4;     // GPIO 4 - Safe for output  
-const int LED3_PIN   = 5;     // GPIO 5 - Safe for output
-const int BUTTON_PIN = 3;     // GPIO 3 - Safe for input, active-high button with external pulldown
-const int SWITCH_PIN = 7;     // GPIO 7 - Safe for input with external pulldown
-const int DEBUG_LED_PIN = 8;  // GPIO 8 - Safe for output, debug LED
-
-// --- IR Transmitter Object ---
-// IR LED is active-low, so we want the pin HIGH when idle (off).
-IRsend irsend(IR_LED_PIN, true); // true = active low output
-
-// --- LED PWM Configuration for "Magical Glow" ---
-// We use the ESP32's LEDC (LED Control) peripheral for efficient hardware PWM.
-const int LED1_CHAN = 0; // PWM Channel 0
-const int LED2_CHAN = 1; // PWM Channel 1
-const int LED3_CHAN = 2; // PWM Channel 2
-const int PWM_FREQ = 5000; // PWM frequency in Hz
-const int PWM_RESOLUTION = 8; // 8-bit resolution (0-255)
+// Shared with the ESP-IDF build
+#include "board.h"
+#include "alloc_trace.h"
+#include "ble_payloads.h"
+#include "console.h"
+#include "glow.h"
+#include "ir_clock.h"
+#include "ir_sweep.h"
+#include "ir_transmit.h"
+#include "nvs_blob.h"
+#include "ota_http.h"
+#include "persistence.h"
+#include "state_machine.h"
+#include "supply_monitor.h"
+#include "sweep_resume.h"
+#include "usage_stats.h"
 
-// ######################################################################
-// ##                       OTA MODE CONFIGURATION                     ##
-// ######################################################################
-const char* OTA_SSID = "REMO MAGICO!";
-const char* OTA_PASSWORD = "moana123";
+// Pins, IR emitters, LED PWM settings and the OTA access point are defined
+// in board.h
 
 // ######################################################################
-// ##                 IR CODE LIBRARY & STRUCTURES                     ##
+// ##                       IR SWEEP & DISPATCH                        ##
 // ######################################################################
 
-// Struct to hold all information for a single IR command
-struct IRCommand {
-  decode_type_t protocol;
-  uint64_t code;
-  uint16_t bits; // Used for protocols like Sony that have variable bit lengths
-};
-
-// The master list of all IR commands to be sent
-const IRCommand irCommands[] = {
-  // Samsung
-  {SAMSUNG, 0xE0E040BF, 32},
-  {SAMSUNG, 0xE0E019E6, 32},
-  {SAMSUNG, 0xE0E0E01F, 32}, // Samsung Power Toggle - common alternative
-  // LG (NEC)
-  {NEC, 0x20DF10EF, 32},
-  {NEC, 0x20DF23DC, 32},
-  // Sony
-  {SONY, 0xA90, 12}, // 0xA90 is the standard Sony power code
-  {SONY, 0x10A90, 20}, // 20-bit version
-  // Panasonic (using NEC for compatibility)
-  {NEC, 0x40040100BCBD, 32},
-  // Philips (RC6)
-  {RC6, 0xC, 20}, // 0xC is the standard RC6 power code
-  {RC6, 0x10C, 20},
-  // Sharp
-  {SHARP, 0xB54A, 15}, // Standard Sharp power code
-  {SHARP, 0xAA5A, 15}, // Sharp Power Toggle - common alternative
-  // Toshiba (NEC)
-  {NEC, 0x2FD48B7, 32},
-  {NEC, 0x2FD807F, 32},
-  // Vizio (NEC)
-  {NEC, 0x20DF10EF, 32},
-  {NEC, 0x20DF3EC1, 32},
-  // Hisense (NEC)
-  {NEC, 0x20DF40BF, 32},
-  {NEC, 0x25D8C43B, 32},
-  // TCL TV IR codes from DDRBoxman's gist
-  {NEC, 0x57E318E7, 32}, // TCL Power (main power toggle)
-  {NEC, 0x57E316E9, 32}, // TCL Power On
-  {NEC, 0x57E3E817, 32}  // TCL Power (alternate)
-};
-
-const int numCommands = sizeof(irCommands) / sizeof(irCommands[0]);
-int currentCommandIndex = 0;
+// Pacing sets, visiting order, sweep position and A/B measurements
+// (see ir_sweep.h). Pacing is loaded from NVS once at boot.
+IRSweep sweep;
+NvsBlob pacingPrefs;
+const unsigned long LOOP_DELAY_MS = 10; // IR frames run on their own clock (ir_transmit.h)
 
 // ######################################################################
 // ##                  BLUETOOTH SPOOFING CONFIGURATION                ##
@@ -130,102 +81,7 @@ int currentCommandIndex = 0;
 #define MAX_TX_POWER ESP_PWR_LVL_P9   // Default
 #endif
 
-// Apple device spam packets (headphones/earbuds - requires close range)
-const uint8_t APPLE_DEVICES[][31] = {
-  // AirPods
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x02, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // AirPods Pro
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x0e, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // AirPods Max
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x0a, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // AirPods Gen 2
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x0f, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // AirPods Gen 3
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x13, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // AirPods Pro Gen 2
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x14, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // PowerBeats
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x03, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // PowerBeats Pro
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x0b, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Beats Solo Pro
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x0c, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Beats Studio Buds
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x11, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Beats Flex
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x10, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Beats X
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x05, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Beats Solo 3
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x06, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Beats Studio 3
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x09, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Beats Studio Pro
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x17, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Beats Fit Pro
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x12, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Beats Studio Buds Plus
-  {0x1e, 0xff, 0x4c, 0x00, 0x07, 0x19, 0x07, 0x16, 0x20, 0x75, 0xaa, 0x30, 0x01, 0x00, 0x00, 0x45, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
-};
-
-// Apple setup/pairing packets (long range devices like Apple TV)
-const uint8_t APPLE_SETUP_DEVICES[][23] = {
-  // AppleTV Setup
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x01, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // AppleTV Pair
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x06, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // AppleTV New User
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x20, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // AppleTV AppleID Setup
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x2b, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // AppleTV Wireless Audio Sync
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0xc0, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // AppleTV Homekit Setup
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x0d, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // AppleTV Keyboard Setup
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x13, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // AppleTV Connecting to Network
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x27, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // Homepod Setup
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x0b, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // Setup New Phone
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x09, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // Transfer Number
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x02, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // TV Color Balance
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x1e, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00},
-  // Vision Pro
-  {0x16, 0xff, 0x4c, 0x00, 0x04, 0x04, 0x2a, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc1, 0x24, 0x60, 0x4c, 0x95, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00}
-};
-
-// Samsung Galaxy Buds and Android Fast Pair packets (triggers Samsung/Android notifications)
-const uint8_t SAMSUNG_DEVICES[][31] = {
-  // Samsung Galaxy Buds
-  {0x1e, 0xff, 0x75, 0x00, 0x01, 0x00, 0x02, 0x00, 0x01, 0x01, 0xff, 0x00, 0x00, 0x43, 0x21, 0x43, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Samsung Galaxy Buds Pro
-  {0x1e, 0xff, 0x75, 0x00, 0x01, 0x00, 0x02, 0x00, 0x01, 0x02, 0xff, 0x00, 0x00, 0x43, 0x21, 0x43, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Samsung Galaxy Buds2
-  {0x1e, 0xff, 0x75, 0x00, 0x01, 0x00, 0x02, 0x00, 0x01, 0x03, 0xff, 0x00, 0x00, 0x43, 0x21, 0x43, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
-};
-
-// Android Fast Pair packets (triggers Android pairing notifications)
-const uint8_t ANDROID_DEVICES[][31] = {
-  // Google Pixel Buds Pro
-  {0x1e, 0x03, 0x03, 0x2C, 0xFE, 0x16, 0x16, 0x2C, 0xFE, 0x92, 0xBB, 0xBD, 0x02, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Sony WH-1000XM4 
-  {0x1e, 0x03, 0x03, 0x2C, 0xFE, 0x16, 0x16, 0x2C, 0xFE, 0xCD, 0x82, 0x56, 0x02, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // JBL Flip 6
-  {0x1e, 0x03, 0x03, 0x2C, 0xFE, 0x16, 0x16, 0x2C, 0xFE, 0x82, 0x1F, 0x66, 0x02, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Bose NC 700
-  {0x1e, 0x03, 0x03, 0x2C, 0xFE, 0x16, 0x16, 0x2C, 0xFE, 0xF5, 0x24, 0x94, 0x02, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-  // Samsung Galaxy Buds Live (Android Fast Pair)
-  {0x1e, 0x03, 0x03, 0x2C, 0xFE, 0x16, 0x16, 0x2C, 0xFE, 0x92, 0xAD, 0xC9, 0x02, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
-};
-
-const int NUM_APPLE_DEVICES = sizeof(APPLE_DEVICES) / sizeof(APPLE_DEVICES[0]);
-const int NUM_APPLE_SETUP_DEVICES = sizeof(APPLE_SETUP_DEVICES) / sizeof(APPLE_SETUP_DEVICES[0]);
-const int NUM_SAMSUNG_DEVICES = sizeof(SAMSUNG_DEVICES) / sizeof(SAMSUNG_DEVICES[0]);
-const int NUM_ANDROID_DEVICES = sizeof(ANDROID_DEVICES) / sizeof(ANDROID_DEVICES[0]);
+// Payload tables live in ble_payloads.h
 
 // BLE objects and state
 BLEAdvertising* pAdvertising = nullptr;
@@ -239,26 +95,12 @@ uint32_t delayMilliseconds = 30; // Very fast like EvilAppleJuice-ESP32
 // ######################################################################
 // ##                       STATE MACHINE VARIABLES                    ##
 // ######################################################################
-enum DeviceState {
-  STATE_IDLE,
-  STATE_CHECKING_PRESS,
-  STATE_RUNNING_SHORT,
-  STATE_RUNNING_LONG
-};
-
-DeviceState currentState = STATE_IDLE;
-unsigned long lastButtonPressTime = 0;
-unsigned long operationStartTime = 0;
+StateMachine machine = {STATE_IDLE, 0, 0};
 unsigned long lastButtonCheck = 0;
 bool lastButtonState = false;
 bool isOtaMode = false;
 bool breathingInitialized = false; // Track if breathing effect is initialized
 
-// Timing constants
-const unsigned long BUTTON_DEBOUNCE_MS = 50;
-const unsigned long LONG_PRESS_MS = 3000;
-const unsigned long SHORT_PRESS_DURATION_MS = 10000;
-
 // PWM variables for breathing effect
 volatile int currentBrightness = 0;
 volatile bool breathingActive = false;
@@ -269,12 +111,161 @@ volatile int pwmCounter = 0;
 hw_timer_t * timer = NULL;
 portMUX_TYPE timerMux = portMUX_INITIALIZER_UNLOCKED;
 
+// ######################################################################
+// ##                     LIFETIME USAGE STATISTICS                    ##
+// ######################################################################
+
+// Counters and flush policy in usage_stats.h; the blob is written here
+UsageTracker usage;
+NvsBlob statsPrefs;
+
+// ######################################################################
+// ##                      BATTERY SUPPLY MONITOR                      ##
+// ######################################################################
+
+// Sampled between IR frames when battery sense is fitted (see board.h)
+SupplyMonitor supply;
+
+// ######################################################################
+// ##                     HEAP ALLOCATION TRACKING                     ##
+// ######################################################################
+
+// Once setup() returns, the firmware's own Play mode code (the loop, the IR
+// frame clock and the supply task) must not touch the heap: payloads come
+// from flash tables and every buffer is static, so days of operation cannot
+// fragment it. Building with MOANA_ALLOC_TRACE (see the
+// esp32-c3-alloc-trace env) wraps the heap_caps allocator at link time and
+// counts every allocation and free after setup, from every task
+// (alloc_trace.h), keeping the caller address of the most recent ones for
+// addr2line. malloc(), calloc() and realloc(), newlib's included, end up in
+// heap_caps_malloc_default / heap_caps_realloc_default; FreeRTOS, esp_timer
+// and the drivers call heap_caps_malloc and friends directly; every free
+// goes through heap_caps_free.
+//
+// BLE advertising is not heap-free. Each cycleBLEDevice() call (every 30 ms
+// while active) goes through the Arduino BLE wrapper and Bluedroid, which
+// allocate on the loop task and free in their own tasks; those show up in
+// the report, and allocs and frees across all tasks should stay level.
+// Demo/OTA mode uploads allocate in the HTTP server task per request.
+#ifdef MOANA_ALLOC_TRACE
+AllocTrace allocTrace;
+portMUX_TYPE allocTraceMux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline void recordAllocation(size_t size, void* caller) {
+  // Check the armed flag first: the heap is used before the scheduler starts
+  if (!allocTrace.armed) {
+    return;
+  }
+  portENTER_CRITICAL_SAFE(&allocTraceMux);
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  allocTraceRecordAlloc(allocTrace, task, pcTaskGetName(task), size, caller);
+  portEXIT_CRITICAL_SAFE(&allocTraceMux);
+}
+
+static inline void recordFree(void* ptr) {
+  if (!allocTrace.armed || !ptr) {
+    return;
+  }
+  portENTER_CRITICAL_SAFE(&allocTraceMux);
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  allocTraceRecordFree(allocTrace, task, pcTaskGetName(task));
+  portEXIT_CRITICAL_SAFE(&allocTraceMux);
+}
+
+extern "C" {
+void* __real_heap_caps_malloc_default(size_t size);
+void* __real_heap_caps_realloc_default(void* ptr, size_t size);
+void* __real_heap_caps_malloc(size_t size, uint32_t caps);
+void* __real_heap_caps_calloc(size_t count, size_t size, uint32_t caps);
+void* __real_heap_caps_realloc(void* ptr, size_t size, uint32_t caps);
+void* __real_heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps);
+void __real_heap_caps_free(void* ptr);
+
+void* __wrap_heap_caps_malloc_default(size_t size) {
+  recordAllocation(size, __builtin_return_address(0));
+  return __real_heap_caps_malloc_default(size);
+}
+
+void* __wrap_heap_caps_realloc_default(void* ptr, size_t size) {
+  recordAllocation(size, __builtin_return_address(0));
+  return __real_heap_caps_realloc_default(ptr, size);
+}
+
+void* __wrap_heap_caps_malloc(size_t size, uint32_t caps) {
+  recordAllocation(size, __builtin_return_address(0));
+  return __real_heap_caps_malloc(size, caps);
+}
+
+void* __wrap_heap_caps_calloc(size_t count, size_t size, uint32_t caps) {
+  recordAllocation(count * size, __builtin_return_address(0));
+  return __real_heap_caps_calloc(count, size, caps);
+}
+
+void* __wrap_heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+  recordAllocation(size, __builtin_return_address(0));
+  return __real_heap_caps_realloc(ptr, size, caps);
+}
+
+void* __wrap_heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) {
+  recordAllocation(size, __builtin_return_address(0));
+  return __real_heap_caps_aligned_alloc(alignment, size, caps);
+}
+
+void __wrap_heap_caps_free(void* ptr) {
+  recordFree(ptr);
+  __real_heap_caps_free(ptr);
+}
+}
+
+/**
+ * @brief Starts counting allocations made by every task
+ */
+void armAllocationTrace() {
+  portENTER_CRITICAL(&allocTraceMux);
+  allocTraceArm(allocTrace);
+  portEXIT_CRITICAL(&allocTraceMux);
+  Serial.println("Allocation trace armed - heap use of every task will be reported");
+}
+
+/**
+ * @brief Prints the per-task counts and the allocations recorded since the last report
+ */
+void printAllocationReport() {
+  static AllocTrace report; // Printed from a copy, the counters keep running meanwhile
+  portENTER_CRITICAL(&allocTraceMux);
+  report = allocTrace;
+  allocTrace.reported = allocTrace.allocs;
+  portEXIT_CRITICAL(&allocTraceMux);
+
+  consolePrintf("Heap allocations since setup: %u\n", (unsigned)report.allocs);
+  for (int i = 0; i < report.taskCount; i++) {
+    const AllocTaskCount& task = report.tasks[i];
+    consolePrintf("  %-16s %u allocs (%u bytes), %u frees\n", task.name, (unsigned)task.allocs,
+                  (unsigned)task.bytes, (unsigned)task.frees);
+  }
+  if (report.otherAllocs > 0) {
+    consolePrintf("  %-16s %u allocs\n", "(other tasks)", (unsigned)report.otherAllocs);
+  }
+
+  uint32_t first = report.reported;
+  if (report.allocs - first > ALLOC_TRACE_SLOTS) {
+    first = report.allocs - ALLOC_TRACE_SLOTS; // Older entries were overwritten
+  }
+  for (uint32_t i = first; i < report.allocs; i++) {
+    const AllocRecord& rec = report.log[i % ALLOC_TRACE_SLOTS];
+    consolePrintf("  ALLOC: %u bytes on %s from caller 0x%08x\n", (unsigned)rec.size,
+                  allocTraceTaskName(report, rec.task), (unsigned)(uintptr_t)rec.caller);
+  }
+}
+#else
+inline void armAllocationTrace() {}
+inline void printAllocationReport() {}
+#endif
+
 // ######################################################################
 // ##                       FORWARD DECLARATIONS                       ##
 // ######################################################################
-void setupOTA();
 void handleMagicalGlow();
-void sendNextIrCode();
 void handleButtonPress();
 void updateStateMachine();
 void IRAM_ATTR onTimer();
@@ -284,6 +275,15 @@ void handleBLESpoofing();
 void cycleBLEDevice();
 void printFlashInfo();
 void optimizedOTASetup();
+void stopActivity();
+bool savePacing();
+void handleSerialCommands();
+void serviceUsageStats(unsigned long now);
+void onActivationEnd(unsigned long now);
+void flushUsageStats();
+void otaFlushUsageStats();
+void setupSupplyMonitor();
+uint16_t readBatteryMv();
 
 // ######################################################################
 // ##                          SETUP FUNCTION                          ##
@@ -300,20 +300,30 @@ void setup() {
   // Print flash information for debugging
   printFlashInfo();
 
+  // Load IR pacing from NVS before anything is sent
+  loadPacing(sweep, pacingPrefs);
+
+  // Continue the IR sweep where it stopped before the last reset
+  loadSweepResumeState(sweep);
+
+  // Lifetime usage counters
+  loadUsageStats(usage, statsPrefs, millis());
+
   // --- Configure GPIOs ---
   // Button with external pulldown for active-high operation
   pinMode(BUTTON_PIN, INPUT);         // External pulldown, active-high button
   pinMode(SWITCH_PIN, INPUT);         // External pulldown as mentioned by user
   
-  // Outputs
-  pinMode(IR_LED_PIN, OUTPUT);
+  // Outputs (IR emitter pins are configured by the RMT driver)
   pinMode(LED1_PIN, OUTPUT);
   pinMode(LED2_PIN, OUTPUT);
   pinMode(LED3_PIN, OUTPUT);
   pinMode(DEBUG_LED_PIN, OUTPUT);
 
-  // --- Initialize IR Sender ---
-  irsend.begin();
+  // --- Initialize IR Emitters ---
+  static const IrTransmitContext irContext = {&sweep, &machine, &supply, &usage, readBatteryMv};
+  irTransmitInstall(irContext);
+  setupSupplyMonitor();
 
   // --- Initialize LEDs (turn off initially) ---
   // For active-low LEDs: HIGH = off, LOW = on
@@ -351,6 +361,14 @@ void setup() {
   setupTimer();
   
   Serial.println("Initialization complete. Entering main loop...");
+  
+  // Compare with the same line from the ESP-IDF build (env:esp32-c3-idf)
+  Serial.print("Boot time: ");
+  Serial.print(micros() / 1000);
+  Serial.println(" ms");
+  
+  // Everything the loop needs is allocated by now
+  armAllocationTrace();
 }
 
 
@@ -359,7 +377,6 @@ void setup() {
 // ######################################################################
 void loop() {
   static unsigned long lastDebugPrint = 0;
-  static unsigned long lastOtaHandle = 0;
   static unsigned long lastWatchdogFeed = 0;
   unsigned long now = millis();
   
@@ -369,10 +386,22 @@ void loop() {
     lastWatchdogFeed = now;
   }
   
+  // A firmware upload request owns the device while it is being handled
+  if (otaHttpPausesLoop(stopActivity)) {
+    delay(LOOP_DELAY_MS);
+    return;
+  }
+  
+  // Accumulate usage time and flush counters to NVS when due
+  serviceUsageStats(now);
+  
+  // Messages from the IR frame clock and the battery sampling
+  irTransmitService();
+  
   // Debug output every 5 seconds to show the device is running
   if (now - lastDebugPrint >= 5000) {
     Serial.print("Loop running, State: ");
-    Serial.print(currentState);
+    Serial.print(machine.state);
     Serial.print(", Button: ");
     Serial.print(digitalRead(BUTTON_PIN) ? "HIGH" : "LOW");
     Serial.print(", Switch: ");
@@ -380,14 +409,16 @@ void loop() {
     Serial.print(", Mode: ");
     Serial.print(isOtaMode ? "OTA" : "Play");
     Serial.print(", BLE: ");
-    if (currentState != STATE_IDLE && bleInitialized) {
+    if (machine.state != STATE_IDLE && bleInitialized) {
       Serial.print("ACTIVE (Apple/Samsung/Android Spam)");
     } else {
       Serial.print("IDLE");
     }
+    irTransmitPrintStatus();
     Serial.print(", Free heap: ");
     Serial.print(ESP.getFreeHeap());
     Serial.println(" bytes");
+    printAllocationReport();
     lastDebugPrint = now;
     
     // Visual feedback: Blink debug LED differently based on mode
@@ -408,6 +439,9 @@ void loop() {
     }
   }
   
+  // Serial commands (pacing, A/B benchmark)
+  handleSerialCommands();
+  
   // Always handle button press first, regardless of mode
   handleButtonPress();
   
@@ -415,24 +449,14 @@ void loop() {
   updateStateMachine();
   
   // Handle LED, IR operations and Bluetooth spoofing when in running states - works in both modes
-  if (currentState == STATE_CHECKING_PRESS || currentState == STATE_RUNNING_SHORT || currentState == STATE_RUNNING_LONG) {
+  bool isActive = stateMachineActive(machine);
+  if (isActive) {
     handleMagicalGlow();
-    sendNextIrCode();
     handleBLESpoofing(); // Only spoof Bluetooth when device is active
   }
   
-  // Handle OTA if in OTA mode - but not too frequently to prevent blocking
-  if (isOtaMode && (now - lastOtaHandle >= 50)) {
-    try {
-      ArduinoOTA.handle();
-    } catch (...) {
-      Serial.println("OTA handle exception caught, continuing...");
-    }
-    lastOtaHandle = now;
-  }
-  
-  // Small delay to prevent overwhelming the system
-  delay(10);
+  // IR frames are started by the frame clock, so loop() keeps a fixed pace
+  delay(LOOP_DELAY_MS);
 }
 
 
@@ -454,8 +478,6 @@ void handleButtonPress() {
     
     // Detect button press (transition from LOW to HIGH for active-high button)
     if (currentButtonState && !lastButtonState) {
-      lastButtonPressTime = now;
-      
       if (isOtaMode) {
         // In OTA mode: Start OTA exit timer OR start normal operation
         otaModeExitStartTime = now;
@@ -464,12 +486,11 @@ void handleButtonPress() {
       }
       
       // Always allow normal button operation if in idle state
-      if (currentState == STATE_IDLE) {
+      if (stateMachinePress(machine, now) == STATE_EVENT_ACTIVATED) {
         Serial.println("Button press detected! Starting operation immediately...");
-        currentState = STATE_CHECKING_PRESS;
-        operationStartTime = now; // Start timing immediately
         breathingActive = true; // Start breathing effect
         breathingStartTime = now;
+        irTransmitBegin();
         
         // Start BLE spam when device becomes active
         if (bleInitialized) {
@@ -493,7 +514,7 @@ void handleButtonPress() {
         Serial.println("Button held for 5+ seconds in OTA mode - EXITING OTA MODE!");
         
         // Stop WiFi and OTA
-        ArduinoOTA.end();
+        otaHttpStop();
         WiFi.softAPdisconnect(true);
         WiFi.mode(WIFI_OFF);
         delay(500);
@@ -502,7 +523,7 @@ void handleButtonPress() {
         isOtaMode = false;
         
         // Reset state machine
-        currentState = STATE_IDLE;
+        machine.state = STATE_IDLE;
         breathingActive = false;
         
         // Stop BLE advertising when exiting OTA mode
@@ -521,7 +542,7 @@ void handleButtonPress() {
         
         // Reset timers
         otaExitInProgress = false;
-        lastButtonPressTime = now;
+        machine.lastButtonPressTime = now;
       }
     }
     
@@ -552,210 +573,40 @@ void handleButtonPress() {
  */
 void updateStateMachine() {
   unsigned long now = millis();
+  DeviceState previous = machine.state;
   
-  switch (currentState) {
-    case STATE_IDLE:
-      // Do nothing, wait for button press
-      // No delay needed here as we have delay in main loop
+  switch (stateMachineUpdate(machine, digitalRead(BUTTON_PIN), now)) {
+    case STATE_EVENT_LONG_PRESS:
+      Serial.println("Long press threshold reached! Continuing until button release...");
+      usageTrackerRecordPress(usage, true);
       break;
       
-    case STATE_CHECKING_PRESS:
-      if (digitalRead(BUTTON_PIN)) {
-        // Button still pressed (HIGH), check if it's been long enough for long press
-        if (now - lastButtonPressTime >= LONG_PRESS_MS) {
-          Serial.println("Long press threshold reached! Continuing until button release...");
-          currentState = STATE_RUNNING_LONG;
-          // Keep the same operationStartTime so timing continues from button press
-        }
-      } else {
-        // Button released (LOW) before long press threshold
-        Serial.println("Short press completed! Will run for 10 seconds total...");
-        currentState = STATE_RUNNING_SHORT;
-        // Keep the same operationStartTime so timing continues from button press
-      }
+    case STATE_EVENT_SHORT_PRESS:
+      Serial.println("Short press completed! Will run for 10 seconds total...");
+      usageTrackerRecordPress(usage, false);
       break;
       
-    case STATE_RUNNING_SHORT:
-      // Check if 10 seconds have elapsed from the initial button press
-      if (now - operationStartTime >= SHORT_PRESS_DURATION_MS) {
-        Serial.println("Short press timer expired. Returning to idle.");
-        currentState = STATE_IDLE;
-        breathingActive = false; // Stop breathing effect
-        // Stop BLE advertising when going idle
-        if (bleInitialized && pAdvertising) {
-          pAdvertising->stop();
-          Serial.println("BLE advertising stopped");
-        }
-        // Turn off LEDs
-        digitalWrite(LED1_PIN, HIGH);
-        digitalWrite(LED2_PIN, HIGH);
-        digitalWrite(LED3_PIN, HIGH);
+    case STATE_EVENT_FINISHED:
+      Serial.println(previous == STATE_RUNNING_SHORT ? "Short press timer expired. Returning to idle."
+                                                     : "Button released. Returning to idle.");
+      breathingActive = false; // Stop breathing effect
+      // Stop BLE advertising when going idle
+      if (bleInitialized && pAdvertising) {
+        pAdvertising->stop();
+        Serial.println("BLE advertising stopped");
       }
+      // Turn off LEDs
+      digitalWrite(LED1_PIN, HIGH);
+      digitalWrite(LED2_PIN, HIGH);
+      digitalWrite(LED3_PIN, HIGH);
+      onActivationEnd(now);
       break;
       
-    case STATE_RUNNING_LONG:
-      // Check if button has been released (active-high button goes LOW when released)
-      if (!digitalRead(BUTTON_PIN)) {
-        Serial.println("Button released. Returning to idle.");
-        currentState = STATE_IDLE;
-        breathingActive = false; // Stop breathing effect
-        // Stop BLE advertising when going idle
-        if (bleInitialized && pAdvertising) {
-          pAdvertising->stop();
-          Serial.println("BLE advertising stopped");
-        }
-        // Turn off LEDs
-        digitalWrite(LED1_PIN, HIGH);
-        digitalWrite(LED2_PIN, HIGH);
-        digitalWrite(LED3_PIN, HIGH);
-      }
+    default:
       break;
   }
 }
 
-/**
- * @brief Sets up the Wi-Fi Access Point and OTA handlers.
- */
-void setupOTA() {
-  Serial.println("Setting up OTA Access Point...");
-  
-  // Add a safety check to prevent infinite setup loops
-  static bool otaSetupAttempted = false;
-  if (otaSetupAttempted) {
-    Serial.println("OTA setup already attempted, skipping to prevent bootloop");
-    return;
-  }
-  otaSetupAttempted = true;
-  
-  // ESP32-C3 specific: Ensure WiFi is properly reset
-  Serial.println("Resetting WiFi subsystem...");
-  WiFi.mode(WIFI_OFF);
-  delay(500); // Longer delay for ESP32-C3
-  
-  // Disconnect any existing connections
-  WiFi.disconnect(true);
-  delay(200);
-  
-  // Set WiFi mode to AP only
-  Serial.println("Setting WiFi mode to AP...");
-  if (!WiFi.mode(WIFI_AP)) {
-    Serial.println("Failed to set WiFi mode to AP! Continuing without OTA...");
-    return;
-  }
-  delay(300);
-  
-  // Configure AP with specific settings for ESP32-C3 stability
-  Serial.println("Configuring WiFi AP settings...");
-  WiFi.softAPConfig(
-    IPAddress(192, 168, 4, 1),  // AP IP
-    IPAddress(192, 168, 4, 1),  // Gateway
-    IPAddress(255, 255, 255, 0) // Subnet mask
-  );
-  
-  Serial.println("Starting WiFi AP...");
-  // Use more conservative settings for ESP32-C3
-  bool apStarted = WiFi.softAP(OTA_SSID, OTA_PASSWORD, 1, 0, 1); // Channel 1, not hidden, max 1 connection for stability
-  
-  if (!apStarted) {
-    Serial.println("Failed to start WiFi AP! Retrying once...");
-    delay(1000);
-    apStarted = WiFi.softAP(OTA_SSID, OTA_PASSWORD, 6, 0, 1); // Try different channel with 1 connection
-    
-    if (!apStarted) {
-      Serial.println("Failed to start WiFi AP after retry! Continuing without OTA...");
-      // Disable WiFi completely to save power and prevent issues
-      WiFi.mode(WIFI_OFF);
-      return;
-    }
-  }
-  
-  delay(1000); // Give AP more time to stabilize
-  
-  IPAddress IP = WiFi.softAPIP();
-  Serial.print("AP IP address: ");
-  Serial.println(IP);
-  
-  // Verify AP is actually working
-  if (IP == IPAddress(0, 0, 0, 0)) {
-    Serial.println("AP IP is invalid! OTA setup failed.");
-    WiFi.mode(WIFI_OFF);
-    return;
-  }
-  
-  Serial.println("Setting up OTA handlers...");
-  
-  ArduinoOTA.setHostname("remo-magico");
-  ArduinoOTA.setPassword(OTA_PASSWORD); // Add password protection
-  
-  ArduinoOTA.onStart([]() {
-    String type;
-    if (ArduinoOTA.getCommand() == U_FLASH) {
-      type = "sketch";
-    } else { // U_SPIFFS
-      type = "filesystem";
-    }
-    Serial.println("Start updating " + type);
-    
-    // Stop all background activities during OTA
-    breathingActive = false;
-    currentState = STATE_IDLE;
-    
-    // Disable hardware timer completely during OTA
-    if (timer) {
-      timerAlarmDisable(timer);
-      timerDetachInterrupt(timer);
-      timerEnd(timer);
-      timer = NULL;
-    }
-    
-    // Turn off all LEDs to save power
-    digitalWrite(LED1_PIN, HIGH);
-    digitalWrite(LED2_PIN, HIGH);
-    digitalWrite(LED3_PIN, HIGH);
-    digitalWrite(DEBUG_LED_PIN, LOW);
-    
-    // Disable watchdog during OTA to prevent timeout
-    esp_task_wdt_delete(NULL);
-    
-    Serial.println("All peripherals stopped for OTA");
-  });
-  
-  ArduinoOTA.onEnd([]() {
-    Serial.println("\nOTA End! Rebooting...");
-  });
-  
-  ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-    Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
-  });
-  
-  ArduinoOTA.onError([](ota_error_t error) {
-    Serial.printf("Error[%u]: ", error);
-    if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
-    else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
-    else if (error == OTA_CONNECT_ERROR) Serial.println("Connect Failed");
-    else if (error == OTA_RECEIVE_ERROR) Serial.println("Receive Failed");
-    else if (error == OTA_END_ERROR) Serial.println("End Failed");
-    
-    Serial.println("OTA failed, restarting device...");
-    // Don't try to restart timer, just reboot the device
-    delay(1000);
-    ESP.restart();
-  });
-
-  Serial.println("Starting OTA service...");
-  try {
-    ArduinoOTA.begin();
-    Serial.println("OTA Ready. Connect to WiFi AP: " + String(OTA_SSID));
-    Serial.println("Password: " + String(OTA_PASSWORD));
-    Serial.println("Then go to: http://" + IP.toString() + " for OTA updates");
-    Serial.println("OTA setup completed successfully!");
-  } catch (...) {
-    Serial.println("Exception during OTA begin! Disabling WiFi...");
-    WiFi.mode(WIFI_OFF);
-  }
-}
-
-
 /**
  * @brief Hardware timer interrupt handler for smooth LED PWM
  */
@@ -806,26 +657,16 @@ void handleMagicalGlow() {
   unsigned long now = millis();
   
   // Update brightness calculation every 10ms
-  if (now - lastUpdate >= 10) {
+  if (now - lastUpdate >= GLOW_UPDATE_MS) {
     lastUpdate = now;
     
     if (breathingActive) {
-      // Calculate time elapsed since breathing started
-      unsigned long elapsedTime = now - breathingStartTime;
-      
-      // Base breathing period starts at 4 seconds, accelerates to 0.5 seconds over 10 seconds
-      float accelerationFactor = min(elapsedTime / 10000.0f, 1.0f); // 0 to 1 over 10 seconds
-      float breathingPeriod = 4000.0f - (3500.0f * accelerationFactor); // 4000ms to 500ms
-      
-      // Calculate breathing phase (0 to 2π for one complete breath cycle)
-      float phase = (2.0f * PI * (now % (unsigned long)breathingPeriod)) / breathingPeriod;
-      
-      // Calculate brightness using sine wave for smooth breathing
-      float sineValue = sin(phase);
+      // Breathing curve shared with the ESP-IDF build (glow.h)
+      uint8_t brightness = glowBrightness(now - breathingStartTime, now);
       
       // Critical section to update brightness value
       portENTER_CRITICAL(&timerMux);
-      currentBrightness = (int)((sineValue + 1.0f) * 50.0f); // Maps -1,1 to 0,100
+      currentBrightness = brightness;
       portEXIT_CRITICAL(&timerMux);
     } else {
       // Turn off LEDs when not breathing
@@ -837,38 +678,119 @@ void handleMagicalGlow() {
 }
 
 /**
- * @brief Sends the next IR code from the global command list.
+ * @brief Starts the supply monitor if battery sense is fitted
  */
-void sendNextIrCode() {
-  const IRCommand& cmd = irCommands[currentCommandIndex];
+void setupSupplyMonitor() {
+#ifdef BATTERY_SENSE_PIN
+  analogSetPinAttenuation(BATTERY_SENSE_PIN, ADC_11db); // Up to ~2.5 V at the pin
+  supplyMonitorInit(supply, true, esp_reset_reason() == ESP_RST_BROWNOUT);
+  // The first read sets up ADC calibration, which allocates; keep it out of the loop
+  Serial.print("Battery: ");
+  Serial.print(readBatteryMv());
+  Serial.print(" mV at rest, IR drive level ");
+  Serial.println(supply.level);
+#else
+  supplyMonitorInit(supply, false, false);
+  Serial.println("Battery sense not fitted - IR drive is not throttled");
+#endif
+}
 
-  // Use a switch to call the correct function from the IRremoteESP8266 library
-  switch (cmd.protocol) {
-    case SAMSUNG:
-      irsend.sendSAMSUNG(cmd.code, cmd.bits);
-      break;
-    case NEC:
-      irsend.sendNEC(cmd.code, cmd.bits);
-      break;
-    case SONY:
-      irsend.sendSony(cmd.code, cmd.bits);
-      break;
-    case RC6:
-      irsend.sendRC6(cmd.code, cmd.bits);
-      break;
-    case SHARP:
-      irsend.sendSharpRaw(cmd.code, cmd.bits); // Using sendSharpRaw is more reliable
-      break;
-    default:
-      // Fallback to NEC for unknown protocols
-      irsend.sendNEC(cmd.code, cmd.bits);
-      break;
+/**
+ * @brief Battery voltage in mV, averaged over BATTERY_SAMPLES reads
+ */
+uint16_t readBatteryMv() {
+#ifdef BATTERY_SENSE_PIN
+  uint32_t sum = 0;
+  for (int i = 0; i < BATTERY_SAMPLES; i++) {
+    sum += analogReadMilliVolts(BATTERY_SENSE_PIN);
   }
-  
-  //Serial.printf("Sent command %d, protocol %d, code 0x%llX\n", currentCommandIndex, cmd.protocol, cmd.code);
+  return sum * BATTERY_DIVIDER_RATIO / BATTERY_SAMPLES;
+#else
+  return 0;
+#endif
+}
+
+// ######################################################################
+// ##                    PERSISTENT STATE (NVS)                        ##
+// ######################################################################
+
+/**
+ * @brief Stores both pacing sets in NVS ("save" command; caller holds irClockLock())
+ */
+bool savePacing() {
+  return savePacing(sweep, pacingPrefs);
+}
+
+/**
+ * @brief Accumulates time counters and applies the idle flush policy (every loop)
+ */
+void serviceUsageStats(unsigned long now) {
+  irClockLock(); // Bursts are counted by the frame clock
+  if (usageTrackerService(usage, machine.state, now)) {
+    flushUsageStats();
+  }
+  irClockUnlock();
+}
+
+/**
+ * @brief Flushes pending events when an activation returns to idle (rate limited)
+ */
+void onActivationEnd(unsigned long now) {
+  irClockLock();
+  if (usageTrackerActivationEndDue(usage, now)) {
+    flushUsageStats();
+  }
+  irClockUnlock();
+}
+
+/**
+ * @brief Writes the counters to NVS now (caller holds irClockLock())
+ */
+void flushUsageStats() {
+  flushUsageStats(usage, statsPrefs, millis());
+}
+
+/**
+ * @brief Writes the counters to NVS from the OTA HTTP server task
+ */
+void otaFlushUsageStats() {
+  irClockLock();
+  flushUsageStats();
+  irClockUnlock();
+}
+
+// ######################################################################
+// ##                     SERIAL COMMAND INTERFACE                     ##
+// ######################################################################
+
+/**
+ * @brief Console output for the shared command interface (console.h).
+ *
+ * Formats into a stack buffer: Serial.printf() falls back to malloc for
+ * long lines. Called from the loop task and the OTA HTTP server task.
+ */
+void consolePrintf(const char* format, ...) {
+  char buffer[128];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  Serial.print(buffer);
+}
 
-  // Increment and wrap the index to loop through all commands
-  currentCommandIndex = (currentCommandIndex + 1) % numCommands;
+/**
+ * @brief Collects serial input into a static line buffer and runs complete lines
+ */
+void handleSerialCommands() {
+  static ConsoleLine line;
+  static const ConsoleContext context = {&sweep, &usage, &supply, savePacing, flushUsageStats,
+                                         irClockLock, irClockUnlock};
+  
+  while (Serial.available() > 0) {
+    if (consoleLineFeed(line, Serial.read())) {
+      consoleExecute(line.text, context); // Takes the clock lock itself, prints outside it
+    }
+  }
 }
 
 // ######################################################################
@@ -897,6 +819,12 @@ void setupBLE() {
       esp_bd_addr_t null_addr = {0xFE, 0xED, 0xC0, 0xFF, 0xEE, 0x69};
       pAdvertising->setDeviceAddress(null_addr, BLE_ADDR_TYPE_RANDOM);
       
+      // Install custom advertising data once through the wrapper so start()
+      // keeps the raw payloads cycleBLEDevice() writes instead of rebuilding
+      // its own from the service list
+      BLEAdvertisementData customData;
+      pAdvertising->setAdvertisementData(customData);
+      
       bleInitialized = true;
       Serial.println("BLE initialized successfully (spam will start on button press)");
     } else {
@@ -936,58 +864,11 @@ void cycleBLEDevice() {
     // Set the random MAC address
     pAdvertising->setDeviceAddress(dummy_addr, BLE_ADDR_TYPE_RANDOM);
     
-    BLEAdvertisementData oAdvertisementData = BLEAdvertisementData();
-    
-    // Randomly pick data from one of the device types
+    // Randomly pick data from one of the device families
     // 0 = Apple headphones, 1 = Apple setup, 2 = Samsung devices, 3 = Android Fast Pair
-    int device_choice = random(4);
-    String deviceName = "";
-    
-    if (device_choice == 0) {
-      // Use Apple headphones packets
-      int index = random(NUM_APPLE_DEVICES);
-      #ifdef ESP_ARDUINO_VERSION_MAJOR
-        #if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
-          oAdvertisementData.addData(String((char*)APPLE_DEVICES[index], 31));
-        #else
-          oAdvertisementData.addData(std::string((char*)APPLE_DEVICES[index], 31));
-        #endif
-      #endif
-      deviceName = "Apple Audio " + String(index);
-    } else if (device_choice == 1) {
-      // Use Apple setup devices packets  
-      int index = random(NUM_APPLE_SETUP_DEVICES);
-      #ifdef ESP_ARDUINO_VERSION_MAJOR
-        #if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
-          oAdvertisementData.addData(String((char*)APPLE_SETUP_DEVICES[index], 23));
-        #else
-          oAdvertisementData.addData(std::string((char*)APPLE_SETUP_DEVICES[index], 23));
-        #endif
-      #endif
-      deviceName = "Apple Setup " + String(index);
-    } else if (device_choice == 2) {
-      // Use Samsung Galaxy Buds packets for Samsung phones
-      int index = random(NUM_SAMSUNG_DEVICES);
-      #ifdef ESP_ARDUINO_VERSION_MAJOR
-        #if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
-          oAdvertisementData.addData(String((char*)SAMSUNG_DEVICES[index], 31));
-        #else
-          oAdvertisementData.addData(std::string((char*)SAMSUNG_DEVICES[index], 31));
-        #endif
-      #endif
-      deviceName = "Samsung Galaxy " + String(index);
-    } else {
-      // Use Android Fast Pair packets for Samsung and other Android phones
-      int index = random(NUM_ANDROID_DEVICES);
-      #ifdef ESP_ARDUINO_VERSION_MAJOR
-        #if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
-          oAdvertisementData.addData(String((char*)ANDROID_DEVICES[index], 31));
-        #else
-          oAdvertisementData.addData(std::string((char*)ANDROID_DEVICES[index], 31));
-        #endif
-      #endif
-      deviceName = "Android FastPair " + String(index);
-    }
+    const BLEDeviceFamily& family = BLE_DEVICE_FAMILIES[random(NUM_BLE_DEVICE_FAMILIES)];
+    int index = random(family.count);
+    const uint8_t* payload = family.packets + index * family.stride;
     
     // Randomly use different advertising PDU types (like EvilAppleJuice-ESP32)
     // This increases detectability of spoofed packets and effectiveness
@@ -1000,8 +881,9 @@ void cycleBLEDevice() {
       pAdvertising->setAdvertisementType(ADV_TYPE_NONCONN_IND);
     }
     
-    // Set advertisement data
-    pAdvertising->setAdvertisementData(oAdvertisementData);
+    // Set advertisement data straight from the flash table; the GAP layer
+    // copies it, so no BLEAdvertisementData/std::string is built per cycle
+    esp_ble_gap_config_adv_data_raw(const_cast<uint8_t*>(payload), family.length);
     
     // Use Apple's recommended 20ms interval for maximum discovery probability
     // (Sometimes disabled for even more aggressive spamming)
@@ -1012,7 +894,9 @@ void cycleBLEDevice() {
     pAdvertising->start();
     
     Serial.print("� BLE SPAM: ");
-    Serial.println(deviceName);
+    Serial.print(family.name);
+    Serial.print(' ');
+    Serial.println(index);
     
     // Random signal strength like EvilAppleJuice-ESP32 for better stealth
     int rand_val = random(100);
@@ -1038,7 +922,7 @@ void cycleBLEDevice() {
  */
 void handleBLESpoofing() {
   // Only run BLE spam when device is in active state
-  if (!bleInitialized || (currentState == STATE_IDLE)) {
+  if (!bleInitialized || (machine.state == STATE_IDLE)) {
     return;
   }
   
@@ -1152,80 +1036,35 @@ void optimizedOTASetup() {
   Serial.print("OTA AP IP: ");
   Serial.println(IP);
   
-  // Configure OTA with minimal settings
-  ArduinoOTA.setHostname("remo-magico");
-  ArduinoOTA.setPassword(OTA_PASSWORD);
-  
-  // Optimized OTA callbacks
-  ArduinoOTA.onStart([]() {
-    Serial.println("OTA Start - CRITICAL: Do not power off!");
-    
-    // Stop ALL activities immediately
-    breathingActive = false;
-    currentState = STATE_IDLE;
-    
-    // Disable timer to free memory
-    if (timer) {
-      timerAlarmDisable(timer);
-      timerDetachInterrupt(timer);
-      timerEnd(timer);
-      timer = NULL;
-    }
-    
-    // Stop BLE to free memory
-    if (bleInitialized && pAdvertising) {
-      pAdvertising->stop();
-      BLEDevice::deinit(false);
-      bleInitialized = false;
-    }
-    
-    // Turn off all peripherals
-    digitalWrite(LED1_PIN, HIGH);
-    digitalWrite(LED2_PIN, HIGH);
-    digitalWrite(LED3_PIN, HIGH);
-    digitalWrite(DEBUG_LED_PIN, LOW);
-    
-    // Disable watchdog
-    esp_task_wdt_delete(NULL);
-    
-    Serial.println("System prepared for OTA update");
-  });
-  
-  ArduinoOTA.onEnd([]() {
-    Serial.println("OTA Complete! Rebooting...");
-  });
-  
-  ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-    static unsigned long lastPrint = 0;
-    unsigned long now = millis();
-    // Print progress less frequently to reduce overhead
-    if (now - lastPrint > 1000) {
-      Serial.printf("OTA Progress: %u%%\n", (progress / (total / 100)));
-      lastPrint = now;
-    }
-  });
-  
-  ArduinoOTA.onError([](ota_error_t error) {
-    Serial.printf("OTA Error[%u]: ", error);
-    if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
-    else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
-    else if (error == OTA_CONNECT_ERROR) Serial.println("Connect Failed");
-    else if (error == OTA_RECEIVE_ERROR) Serial.println("Receive Failed");
-    else if (error == OTA_END_ERROR) Serial.println("End Failed");
-    
-    Serial.println("OTA failed - rebooting to recover...");
-    delay(1000);
-    ESP.restart();
-  });
-  
-  try {
-    ArduinoOTA.begin();
-    Serial.println("Optimized OTA ready!");
-    Serial.println("Connect to: " + String(OTA_SSID));
-    Serial.println("Password: " + String(OTA_PASSWORD));
-    Serial.println("Upload via: " + IP.toString());
-  } catch (...) {
-    Serial.println("OTA begin failed!");
+  // Resumable, hash-checked uploads over HTTP (see ota_http.h)
+  static const OtaHttpContext context = {&usage, otaFlushUsageStats, OTA_PASSWORD};
+  if (!otaHttpStart(context)) {
+    Serial.println("OTA HTTP server failed to start!");
     WiFi.mode(WIFI_OFF);
+    return;
+  }
+  
+  Serial.println("Optimized OTA ready!");
+  Serial.print("Connect to: ");
+  Serial.println(OTA_SSID);
+  Serial.print("Password: ");
+  Serial.println(OTA_PASSWORD);
+  Serial.print("Upload via: python3 tools/ota_upload.py firmware.bin --host ");
+  Serial.println(IP);
+}
+
+/**
+ * @brief Returns to idle with glow and BLE off (an upload request is starting)
+ */
+void stopActivity() {
+  irClockLock(); // No frame in flight afterwards; the clock stops by itself
+  machine.state = STATE_IDLE;
+  irClockUnlock();
+  breathingActive = false;
+  digitalWrite(LED1_PIN, HIGH);
+  digitalWrite(LED2_PIN, HIGH);
+  digitalWrite(LED3_PIN, HIGH);
+  if (bleInitialized && pAdvertising) {
+    pAdvertising->stop();
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,271 @@
+/*
+ * Heap allocation trace: per-task counting as the firmware's allocator
+ * wrappers feed it, and the shared Play mode logic run under a counting
+ * allocator. On glibc hosts malloc, calloc, realloc and free (and with them
+ * operator new) are interposed here and feed the same trace, so any
+ * allocation the simulated loop, frame clock or BLE cycling makes shows up
+ * as a failure with its count.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "alloc_trace.h"
+#include "ble_payloads.h"
+#include "frame_timing.h"
+#include "glow.h"
+#include "ir_codes.h"
+#include "ir_dispatch.h"
+#include "ir_encoder.h"
+#include "ir_sweep.h"
+#include "state_machine.h"
+#include "supply_monitor.h"
+#include "usage_stats.h"
+
+// Stand-ins for FreeRTOS task handles
+static const int LOOP_TASK = 0;
+static const int TIMER_TASK = 1;
+static const int BTC_TASK = 2;
+static const int HOST_TASK = 3;
+
+static AllocTrace trace;
+
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+  allocTraceRecordAlloc(trace, &HOST_TASK, "host", size, __builtin_return_address(0));
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+  allocTraceRecordAlloc(trace, &HOST_TASK, "host", count * size, __builtin_return_address(0));
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  allocTraceRecordAlloc(trace, &HOST_TASK, "host", size, __builtin_return_address(0));
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+  if (ptr) {
+    allocTraceRecordFree(trace, &HOST_TASK, "host");
+  }
+  __libc_free(ptr);
+}
+}
+#endif
+
+void setUp() {
+  memset(&trace, 0, sizeof(trace));
+}
+
+void tearDown() {
+  trace.armed = false;
+}
+
+void test_nothing_is_counted_before_arming() {
+  allocTraceRecordAlloc(trace, &LOOP_TASK, "loopTask", 64, NULL);
+  allocTraceRecordFree(trace, &LOOP_TASK, "loopTask");
+  TEST_ASSERT_EQUAL_UINT32(0, trace.allocs);
+  TEST_ASSERT_EQUAL_INT(0, trace.taskCount);
+}
+
+void test_allocations_of_every_task_are_counted_separately() {
+  allocTraceArm(trace);
+  // A BLE advertising call: the message is allocated on the loop and freed by Bluedroid
+  allocTraceRecordAlloc(trace, &LOOP_TASK, "loopTask", 40, (const void*)0x42001000);
+  allocTraceRecordAlloc(trace, &BTC_TASK, "BTC_TASK", 24, (const void*)0x42002000);
+  allocTraceRecordFree(trace, &BTC_TASK, "BTC_TASK");
+  allocTraceRecordFree(trace, &BTC_TASK, "BTC_TASK");
+  allocTraceRecordAlloc(trace, &TIMER_TASK, "esp_timer", 16, (const void*)0x42003000);
+
+  TEST_ASSERT_EQUAL_UINT32(3, trace.allocs);
+  TEST_ASSERT_EQUAL_INT(3, trace.taskCount);
+  const AllocTaskCount* loop = allocTraceTask(trace, &LOOP_TASK);
+  const AllocTaskCount* btc = allocTraceTask(trace, &BTC_TASK);
+  const AllocTaskCount* timer = allocTraceTask(trace, &TIMER_TASK);
+  TEST_ASSERT_NOT_NULL(loop);
+  TEST_ASSERT_NOT_NULL(btc);
+  TEST_ASSERT_NOT_NULL(timer);
+  TEST_ASSERT_EQUAL_STRING("loopTask", loop->name);
+  TEST_ASSERT_EQUAL_UINT32(1, loop->allocs);
+  TEST_ASSERT_EQUAL_UINT32(40, loop->bytes);
+  TEST_ASSERT_EQUAL_UINT32(0, loop->frees);
+  TEST_ASSERT_EQUAL_UINT32(1, btc->allocs);
+  TEST_ASSERT_EQUAL_UINT32(2, btc->frees);
+  TEST_ASSERT_EQUAL_STRING("esp_timer", allocTraceTaskName(trace, &TIMER_TASK));
+
+  TEST_ASSERT_TRUE(trace.log[0].task == &LOOP_TASK);
+  TEST_ASSERT_TRUE(trace.log[0].caller == (const void*)0x42001000);
+  TEST_ASSERT_TRUE(trace.log[2].task == &TIMER_TASK);
+  TEST_ASSERT_EQUAL_UINT32(16, trace.log[2].size);
+}
+
+void test_log_keeps_the_most_recent_callers() {
+  allocTraceArm(trace);
+  for (uint32_t i = 0; i < ALLOC_TRACE_SLOTS + 3; i++) {
+    allocTraceRecordAlloc(trace, &LOOP_TASK, "loopTask", i, (const void*)(uintptr_t)(0x1000 + i));
+  }
+  TEST_ASSERT_EQUAL_UINT32(ALLOC_TRACE_SLOTS + 3, trace.allocs);
+  for (uint32_t i = 3; i < ALLOC_TRACE_SLOTS + 3; i++) {
+    TEST_ASSERT_EQUAL_UINT32(i, trace.log[i % ALLOC_TRACE_SLOTS].size);
+  }
+}
+
+void test_tasks_beyond_the_table_are_still_counted() {
+  static const int tasks[ALLOC_TRACE_TASKS + 2] = {0};
+  allocTraceArm(trace);
+  for (int i = 0; i < ALLOC_TRACE_TASKS + 2; i++) {
+    allocTraceRecordAlloc(trace, &tasks[i], NULL, 8, NULL);
+  }
+  TEST_ASSERT_EQUAL_INT(ALLOC_TRACE_TASKS, trace.taskCount);
+  TEST_ASSERT_EQUAL_UINT32(2, trace.otherAllocs);
+  TEST_ASSERT_EQUAL_UINT32(ALLOC_TRACE_TASKS + 2, trace.allocs);
+  TEST_ASSERT_EQUAL_STRING("?", allocTraceTaskName(trace, &tasks[0]));
+}
+
+#ifdef __GLIBC__
+static void* volatile kept; // Keeps the compiler from dropping the malloc/free pair
+
+void test_counting_allocator_reports_a_violation() {
+  allocTraceArm(trace);
+  kept = malloc(48);
+  free(kept);
+  trace.armed = false;
+
+  const AllocTaskCount* host = allocTraceTask(trace, &HOST_TASK);
+  TEST_ASSERT_NOT_NULL(host);
+  TEST_ASSERT_EQUAL_UINT32(1, host->allocs);
+  TEST_ASSERT_EQUAL_UINT32(48, host->bytes);
+  TEST_ASSERT_EQUAL_UINT32(1, host->frees);
+}
+
+const int EMITTERS = 2;
+const uint32_t LONG_HOLD_MS = 5000;
+const uint32_t SHORT_PRESS_AT_MS = 8000;
+const uint32_t RUN_MS = 20000;
+const uint32_t BLE_CYCLE_MS = 30;
+
+// What the Play mode loop and frame clock do with the shared logic, for RUN_MS
+// at 1 ms loop steps: a long press held LONG_HOLD_MS, then a short press
+static uint32_t simulatePlayMode() {
+  static StateMachine machine;
+  static IRSweep sweep;
+  static UsageTracker usage;
+  static SupplyMonitor supply;
+  static IRWaveform wave;
+  static FrameTiming timing;
+  static IRAirSlot slots[EMITTERS];
+  uint32_t readyAtUs[EMITTERS] = {0, 0};
+  uint32_t startedUs[EMITTERS] = {0, 0};
+  uint32_t bursts = 0;
+  uint32_t checksum = 0;
+
+  memset(&machine, 0, sizeof(machine));
+  memset(&usage, 0, sizeof(usage));
+  memset(slots, 0, sizeof(slots));
+  irSweepInit(sweep);
+  irSweepApplyOrder(sweep);
+  irSweepSetAbMode(sweep, true);
+  usageTrackerStart(usage, 0);
+  supplyMonitorInit(supply, true, false);
+  frameTimingReset(timing);
+
+  for (uint32_t now = 1; now < RUN_MS; now++) {
+    bool buttonDown = now < LONG_HOLD_MS || (now >= SHORT_PRESS_AT_MS && now < SHORT_PRESS_AT_MS + 500);
+    if (buttonDown && machine.state == STATE_IDLE &&
+        stateMachinePress(machine, now) == STATE_EVENT_ACTIVATED) {
+      irSweepBeginActivation(sweep);
+      for (int e = 0; e < EMITTERS; e++) {
+        readyAtUs[e] = now * 1000;
+      }
+    }
+    switch (stateMachineUpdate(machine, buttonDown, now)) {
+      case STATE_EVENT_LONG_PRESS:
+        usageTrackerRecordPress(usage, true);
+        break;
+      case STATE_EVENT_SHORT_PRESS:
+        usageTrackerRecordPress(usage, false);
+        break;
+      case STATE_EVENT_FINISHED:
+        if (usageTrackerActivationEndDue(usage, now)) {
+          usageTrackerFlushed(usage, now);
+        }
+        break;
+      default:
+        break;
+    }
+    if (usageTrackerService(usage, machine.state, now)) {
+      usageTrackerFlushed(usage, now);
+    }
+    if (!stateMachineActive(machine)) {
+      continue;
+    }
+
+    if (now % GLOW_UPDATE_MS == 0) {
+      checksum += glowBrightness(now - machine.operationStartTime, now);
+    }
+    if (now % BLE_CYCLE_MS == 0) {
+      const BLEDeviceFamily& family = BLE_DEVICE_FAMILIES[now % NUM_BLE_DEVICE_FAMILIES];
+      checksum += family.packets[(now % family.count) * family.stride];
+    }
+
+    uint32_t nowUs = now * 1000;
+    for (int e = 0; e < EMITTERS; e++) {
+      if ((int32_t)(readyAtUs[e] - nowUs) > 0) {
+        continue;
+      }
+      uint32_t carrierHz = irCarrierHz(irCommands[irSweepNextCommand(sweep)].protocol);
+      uint32_t startUs = irDispatchStart(slots, EMITTERS, e, carrierHz, readyAtUs[e]);
+      if (startUs != readyAtUs[e]) {
+        readyAtUs[e] = startUs;
+        continue;
+      }
+      uint16_t gapMs = irSweepPacing(sweep).frameGapMs;
+      IRSweepStep step = irSweepNext(sweep, startUs, machine.state == STATE_RUNNING_LONG);
+      irEncodeBurst(wave, irCommands[step.command], step.repeats, step.toggle);
+      uint32_t loadOffsetUs = 0;
+      if (supplySampleDue(supply, now) && supplyLoadedSampleOffset(wave, loadOffsetUs)) {
+        supplyMonitorUpdate(supply, 3900, 3700, now);
+      }
+      const SupplyDrive& drive = supplyDrive(supply);
+      if (bursts++ >= (uint32_t)EMITTERS) {
+        frameTimingRecord(timing, startUs - startedUs[e], startUs - startedUs[e]);
+      }
+      usageTrackerRecordBurst(usage, step.command, step.repeats);
+      startedUs[e] = startUs;
+      readyAtUs[e] = startUs + wave.totalUs + (gapMs + drive.extraGapMs) * 1000UL;
+      slots[e].carrierHz = wave.carrierHz;
+      slots[e].untilUs = readyAtUs[e];
+    }
+  }
+  return bursts + (checksum & 1);
+}
+
+void test_play_mode_logic_does_not_allocate() {
+  allocTraceArm(trace);
+  uint32_t bursts = simulatePlayMode();
+  trace.armed = false;
+
+  TEST_ASSERT_GREATER_THAN_UINT32(100, bursts);
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, trace.allocs, "Play mode logic allocated on the heap");
+}
+#endif
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_nothing_is_counted_before_arming);
+  RUN_TEST(test_allocations_of_every_task_are_counted_separately);
+  RUN_TEST(test_log_keeps_the_most_recent_callers);
+  RUN_TEST(test_tasks_beyond_the_table_are_still_counted);
+#ifdef __GLIBC__
+  RUN_TEST(test_counting_allocator_reports_a_violation);
+  RUN_TEST(test_play_mode_logic_does_not_allocate);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,134 @@
+/*
+ * Serial commands against a fake frame clock lock: every command must print
+ * with the lock released (a blocked console would delay frames) and change
+ * or copy the shared state with it held, NVS callbacks included.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "console.h"
+
+static IRSweep sweep;
+static UsageTracker usage;
+static SupplyMonitor supply;
+
+static bool locked;
+static int lockCount;
+static int printsWhileLocked;
+static int prints;
+static int nvsWritesWhileUnlocked;
+static char lastLine[128];
+
+void consolePrintf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vsnprintf(lastLine, sizeof(lastLine), format, args);
+  va_end(args);
+  prints++;
+  if (locked) {
+    printsWhileLocked++;
+  }
+}
+
+static void fakeLock() {
+  TEST_ASSERT_FALSE_MESSAGE(locked, "lock taken twice");
+  locked = true;
+  lockCount++;
+}
+
+static void fakeUnlock() {
+  TEST_ASSERT_TRUE_MESSAGE(locked, "unlock without lock");
+  locked = false;
+}
+
+static bool fakeSavePacing() {
+  if (!locked) {
+    nvsWritesWhileUnlocked++;
+  }
+  return true;
+}
+
+static void fakeFlushUsageStats() {
+  if (!locked) {
+    nvsWritesWhileUnlocked++;
+  }
+}
+
+static const ConsoleContext context = {&sweep, &usage, &supply, fakeSavePacing, fakeFlushUsageStats,
+                                       fakeLock, fakeUnlock};
+
+static void run(const char* command) {
+  char line[sizeof(ConsoleLine::text)];
+  strncpy(line, command, sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+  consoleExecute(line, context);
+  TEST_ASSERT_FALSE_MESSAGE(locked, "lock still held after the command");
+}
+
+void setUp() {
+  irSweepInit(sweep);
+  irSweepApplyOrder(sweep);
+  memset(&usage, 0, sizeof(usage));
+  supplyMonitorInit(supply, true, false);
+  locked = false;
+  lockCount = 0;
+  printsWhileLocked = 0;
+  prints = 0;
+  nvsWritesWhileUnlocked = 0;
+}
+
+void tearDown() {}
+
+void test_every_command_prints_outside_the_lock() {
+  static const char* const COMMANDS[] = {"help", "pacing", "set gap 40", "setb short 2", "set bogus 1",
+                                         "save", "ab on", "ab", "ab off", "ab reset", "stats",
+                                         "stats reset", "supply", "nonsense"};
+  for (size_t i = 0; i < sizeof(COMMANDS) / sizeof(COMMANDS[0]); i++) {
+    int before = prints;
+    run(COMMANDS[i]);
+    TEST_ASSERT_GREATER_THAN_MESSAGE(before, prints, COMMANDS[i]);
+  }
+  TEST_ASSERT_EQUAL_INT(0, printsWhileLocked);
+  TEST_ASSERT_EQUAL_INT(0, nvsWritesWhileUnlocked);
+}
+
+void test_state_changes_are_made_under_the_lock() {
+  run("set gap 40");
+  TEST_ASSERT_EQUAL_INT(1, lockCount);
+  TEST_ASSERT_EQUAL_UINT16(40, sweep.pacingSets[PACING_SET_A].frameGapMs);
+
+  run("ab on");
+  TEST_ASSERT_TRUE(sweep.abModeEnabled);
+  run("ab off");
+  TEST_ASSERT_FALSE(sweep.abModeEnabled);
+
+  usage.stats.shortPresses = 7;
+  run("stats reset");
+  TEST_ASSERT_EQUAL_UINT32(0, usage.stats.shortPresses);
+  TEST_ASSERT_EQUAL_INT(0, nvsWritesWhileUnlocked);
+}
+
+void test_reports_print_the_copied_state() {
+  usage.stats.shortPresses = 3;
+  usage.stats.longPresses = 2;
+  run("stats");
+  TEST_ASSERT_EQUAL_STRING("======================\n\n", lastLine);
+
+  run("pacing");
+  char expected[128];
+  snprintf(expected, sizeof(expected), "Set B: gap=%ums short=%u long=%u order=%s\n",
+           (unsigned)sweep.pacingSets[PACING_SET_B].frameGapMs,
+           (unsigned)sweep.pacingSets[PACING_SET_B].shortPressRepeats,
+           (unsigned)sweep.pacingSets[PACING_SET_B].longPressRepeats,
+           SWEEP_ORDER_NAMES[sweep.pacingSets[PACING_SET_B].sweepOrder]);
+  TEST_ASSERT_EQUAL_STRING(expected, lastLine);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_command_prints_outside_the_lock);
+  RUN_TEST(test_state_changes_are_made_under_the_lock);
+  RUN_TEST(test_reports_print_the_copied_state);
+  return UNITY_END();
+}
@@ -0,0 +1,186 @@
+/*
+ * Sweep split across IR emitters, simulated with the frame clock's rules:
+ * the emitter due first takes the next sweep code, waits if another emitter
+ * has that code's carrier on air, and is due again one pacing gap after its
+ * burst. Frame times come from the encoder, as on the hardware.
+ */
+#include <string.h>
+#include <unity.h>
+#include "ir_codes.h"
+#include "ir_dispatch.h"
+#include "ir_encoder.h"
+#include "ir_sweep.h"
+
+const int MAX_EMITTERS = 2;
+const int SWEEPS = 4;
+
+struct Frame {
+  int emitter;
+  int command;
+  uint32_t startUs;
+  uint32_t endUs;       // Burst end, protocol padding included
+  uint32_t carrierHz;
+};
+
+struct SplitRun {
+  Frame frames[SWEEPS * numCommands];
+  int frameCount;
+  uint32_t sweepUs[SWEEPS];
+  int sweeps;
+};
+
+static IRWaveform wave;
+static IRSweep sweep;
+static SplitRun run;
+
+void setUp() {}
+void tearDown() {}
+
+static void simulate(int emitters, uint8_t order) {
+  irSweepInit(sweep);
+  sweep.pacingSets[PACING_SET_A].sweepOrder = order;
+  irSweepApplyOrder(sweep);
+  irSweepBeginActivation(sweep);
+  memset(&run, 0, sizeof(run));
+
+  IRAirSlot slots[MAX_EMITTERS] = {};
+  uint32_t readyAtUs[MAX_EMITTERS] = {};
+  uint32_t gapUs = irSweepPacing(sweep).frameGapMs * 1000UL;
+
+  while (run.sweeps < SWEEPS) {
+    int e = 0;
+    for (int i = 1; i < emitters; i++) {
+      if ((int32_t)(readyAtUs[i] - readyAtUs[e]) < 0) {
+        e = i;
+      }
+    }
+    uint32_t carrierHz = irCarrierHz(irCommands[irSweepNextCommand(sweep)].protocol);
+    uint32_t startUs = irDispatchStart(slots, emitters, e, carrierHz, readyAtUs[e]);
+    if (startUs != readyAtUs[e]) {
+      readyAtUs[e] = startUs; // Clock re-armed, decided again then
+      continue;
+    }
+
+    IRSweepStep step = irSweepNext(sweep, startUs, false);
+    irEncodeBurst(wave, irCommands[step.command], step.repeats, step.toggle);
+    Frame& frame = run.frames[run.frameCount++];
+    frame.emitter = e;
+    frame.command = step.command;
+    frame.startUs = startUs;
+    frame.endUs = startUs + wave.totalUs;
+    frame.carrierHz = wave.carrierHz;
+
+    readyAtUs[e] = frame.endUs + gapUs;
+    slots[e].carrierHz = wave.carrierHz;
+    slots[e].untilUs = readyAtUs[e];
+    slots[e].startUs = frame.startUs;
+    slots[e].burstEndUs = frame.endUs;
+    if (step.sweepFinished) {
+      run.sweepUs[run.sweeps++] = step.sweepUs;
+    }
+  }
+}
+
+static uint32_t averageSweepUs() {
+  uint64_t sum = 0;
+  for (int i = 1; i < run.sweeps; i++) { // The first sweep starts with every emitter free
+    sum += run.sweepUs[i];
+  }
+  return sum / (run.sweeps - 1);
+}
+
+static void test_dispatch_waits_only_for_the_same_carrier() {
+  IRAirSlot slots[3] = {{NEC_CARRIER_HZ, 5000, 0, 0}, {SONY_CARRIER_HZ, 9000, 0, 0}, {NEC_CARRIER_HZ, 7000, 0, 0}};
+  TEST_ASSERT_EQUAL_UINT32(1000, irDispatchStart(slots, 3, 1, RC6_CARRIER_HZ, 1000));
+  TEST_ASSERT_EQUAL_UINT32(9000, irDispatchStart(slots, 3, 0, SONY_CARRIER_HZ, 1000));
+  TEST_ASSERT_EQUAL_UINT32(7000, irDispatchStart(slots, 3, 1, NEC_CARRIER_HZ, 1000));
+  TEST_ASSERT_EQUAL_UINT32(5000, irDispatchStart(slots, 3, 2, NEC_CARRIER_HZ, 1000));
+  TEST_ASSERT_EQUAL_UINT32(8000, irDispatchStart(slots, 3, 1, NEC_CARRIER_HZ, 8000));
+  TEST_ASSERT_EQUAL_UINT32(9000, irDispatchStart(slots, 1, 0, SONY_CARRIER_HZ, 9000)); // Own slot ignored
+
+  // Microsecond clock wrap: a slot that ended just before it does not hold the carrier
+  IRAirSlot wrapped[2] = {{NEC_CARRIER_HZ, 0, 0, 0}, {NEC_CARRIER_HZ, 0xFFFFF000, 0, 0}};
+  TEST_ASSERT_EQUAL_UINT32(0x1000, irDispatchStart(wrapped, 2, 0, NEC_CARRIER_HZ, 0x1000));
+  wrapped[1].untilUs = 0x2000;
+  TEST_ASSERT_EQUAL_UINT32(0x2000, irDispatchStart(wrapped, 2, 0, NEC_CARRIER_HZ, 0xFFFFF000));
+}
+
+static void test_quiet_only_between_a_burst_and_the_next_frame() {
+  // Burst 1000-3000 us, next frame no earlier than 5000 us
+  IRAirSlot slot = {NEC_CARRIER_HZ, 5000, 1000, 3000};
+  TEST_ASSERT_TRUE(irAirSlotQuiet(slot, 3000, 5000));
+  TEST_ASSERT_TRUE(irAirSlotQuiet(slot, 3500, 4500));
+  TEST_ASSERT_FALSE(irAirSlotQuiet(slot, 2500, 4000));   // Burst still on
+  TEST_ASSERT_FALSE(irAirSlotQuiet(slot, 500, 1500));    // Burst starts inside
+  TEST_ASSERT_FALSE(irAirSlotQuiet(slot, 4000, 6000));   // Next frame may start inside
+
+  // Across the microsecond clock wrap
+  IRAirSlot wrapped = {NEC_CARRIER_HZ, 0x1000, 0xFFFFE000, 0xFFFFF000};
+  TEST_ASSERT_TRUE(irAirSlotQuiet(wrapped, 0xFFFFF800, 0x800));
+  TEST_ASSERT_FALSE(irAirSlotQuiet(wrapped, 0xFFFFE800, 0x800));
+}
+
+static void test_every_code_goes_out_once_per_sweep() {
+  for (uint8_t order = 0; order < SWEEP_ORDER_COUNT; order++) {
+    simulate(MAX_EMITTERS, order);
+    int sent[numCommands] = {};
+    bool used[MAX_EMITTERS] = {};
+    for (int i = 0; i < run.frameCount; i++) {
+      sent[run.frames[i].command]++;
+      used[run.frames[i].emitter] = true;
+    }
+    for (uint32_t c = 0; c < numCommands; c++) {
+      TEST_ASSERT_EQUAL_INT_MESSAGE(SWEEPS, sent[c], SWEEP_ORDER_NAMES[order]);
+    }
+    TEST_ASSERT_TRUE(used[0] && used[1]);
+  }
+}
+
+static void test_same_carrier_frames_never_overlap() {
+  for (uint8_t order = 0; order < SWEEP_ORDER_COUNT; order++) {
+    simulate(MAX_EMITTERS, order);
+    for (int i = 0; i < run.frameCount; i++) {
+      for (int j = i + 1; j < run.frameCount; j++) {
+        const Frame& a = run.frames[i];
+        const Frame& b = run.frames[j];
+        bool overlap = a.startUs < b.endUs && b.startUs < a.endUs;
+        if (a.emitter != b.emitter && a.carrierHz == b.carrierHz) {
+          TEST_ASSERT_FALSE_MESSAGE(overlap, SWEEP_ORDER_NAMES[order]);
+        }
+      }
+    }
+  }
+}
+
+static void test_second_emitter_never_slows_the_sweep() {
+  for (uint8_t order = 0; order < SWEEP_ORDER_COUNT; order++) {
+    simulate(1, order);
+    uint32_t oneEmitterUs = averageSweepUs();
+    simulate(MAX_EMITTERS, order);
+    uint32_t twoEmittersUs = averageSweepUs();
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(oneEmitterUs, twoEmittersUs);
+  }
+}
+
+static void test_other_carriers_go_out_alongside() {
+  simulate(MAX_EMITTERS, SWEEP_INTERLEAVED);
+  int overlapping = 0;
+  for (int i = 0; i + 1 < run.frameCount; i++) {
+    if (run.frames[i + 1].startUs < run.frames[i].endUs) {
+      TEST_ASSERT_NOT_EQUAL(run.frames[i].carrierHz, run.frames[i + 1].carrierHz);
+      overlapping++;
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(0, overlapping);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_dispatch_waits_only_for_the_same_carrier);
+  RUN_TEST(test_quiet_only_between_a_burst_and_the_next_frame);
+  RUN_TEST(test_every_code_goes_out_once_per_sweep);
+  RUN_TEST(test_same_carrier_frames_never_overlap);
+  RUN_TEST(test_second_emitter_never_slows_the_sweep);
+  RUN_TEST(test_other_carriers_go_out_alongside);
+  return UNITY_END();
+}
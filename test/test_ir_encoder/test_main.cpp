@@ -0,0 +1,117 @@
+/*
+ * Burst duration and airtime of long-press bursts against the baseline
+ * firmware, which sent one press per target through IRremoteESP8266: one
+ * frame, three for Sony. The encoder follows that library's timings, so the
+ * baseline is the same command encoded with those repeat counts.
+ */
+#include <unity.h>
+#include "ir_codes.h"
+#include "ir_encoder.h"
+#include "ir_sweep.h"
+
+static IRWaveform wave;
+
+void setUp() {}
+void tearDown() {}
+
+static uint16_t baselineRepeats(const IRCommand& cmd) {
+  return cmd.protocol == IR_SONY ? SONY_MIN_REPEATS : 0;
+}
+
+// Carrier-on time: what the LED draws current for
+static uint32_t markUs(const IRWaveform& w) {
+  uint32_t sum = 0;
+  for (int i = 0; i < w.count; i += 2) {
+    sum += w.durations[i];
+  }
+  return sum;
+}
+
+static void test_frames_are_padded_to_protocol_spacing() {
+  const IRCommand nec = {IR_NEC, 0x20DF10EF, 32};
+  const IRCommand samsung = {IR_SAMSUNG, 0xE0E040BF, 32};
+  const IRCommand sony = {IR_SONY, 0xA90, 12};
+
+  TEST_ASSERT_TRUE(irEncodeBurst(wave, nec, 0, false));
+  TEST_ASSERT_EQUAL_UINT32(NEC_MIN_COMMAND_US, wave.totalUs);
+  TEST_ASSERT_TRUE(irEncodeBurst(wave, samsung, 0, false));
+  TEST_ASSERT_EQUAL_UINT32(SAMSUNG_MIN_MESSAGE_US, wave.totalUs);
+  TEST_ASSERT_TRUE(irEncodeBurst(wave, sony, SONY_MIN_REPEATS, false));
+  TEST_ASSERT_EQUAL_UINT32(3 * SONY_RPT_LENGTH_US, wave.totalUs);
+}
+
+static void test_default_long_press_matches_baseline_per_code() {
+  IRPacing pacing = DEFAULT_PACING;
+  uint64_t heldUs = 0;
+  uint64_t baselineUs = 0;
+
+  for (int i = 0; i < numCommands; i++) {
+    const IRCommand& cmd = irCommands[i];
+    TEST_ASSERT_TRUE(irEncodeBurst(wave, cmd, baselineRepeats(cmd), false));
+    uint32_t baselineBurstUs = wave.totalUs;
+    uint32_t baselineMarkUs = markUs(wave);
+
+    TEST_ASSERT_TRUE(irEncodeBurst(wave, cmd, irBurstRepeats(cmd, pacing, true), false));
+    TEST_ASSERT_EQUAL_UINT32(baselineBurstUs, wave.totalUs);
+    TEST_ASSERT_EQUAL_UINT32(baselineMarkUs, markUs(wave));
+    heldUs += wave.totalUs;
+    baselineUs += baselineBurstUs;
+  }
+  // A whole long-press sweep takes no longer than the baseline sweep
+  TEST_ASSERT_EQUAL_UINT64(baselineUs, heldUs);
+}
+
+static void test_held_repeats_only_for_compact_repeat_protocols() {
+  IRPacing pacing = DEFAULT_PACING;
+  pacing.longPressRepeats = 3;
+
+  for (int i = 0; i < numCommands; i++) {
+    const IRCommand& cmd = irCommands[i];
+    uint16_t repeats = irBurstRepeats(cmd, pacing, true);
+    if (irHasCompactRepeat(cmd.protocol)) {
+      TEST_ASSERT_EQUAL_UINT16(3, repeats);
+    } else {
+      // Lengthening them would only resend full frames
+      TEST_ASSERT_EQUAL_UINT16(baselineRepeats(cmd), repeats);
+    }
+  }
+}
+
+static void test_nec_repeats_cut_airtime_but_not_duration() {
+  const IRCommand nec = {IR_NEC, 0x20DF10EF, 32};
+  TEST_ASSERT_TRUE(irEncodeBurst(wave, nec, 0, false));
+  uint32_t frameMarkUs = markUs(wave);
+
+  TEST_ASSERT_TRUE(irEncodeBurst(wave, nec, 2, false));
+  // Same 108 ms spacing as three full frames...
+  TEST_ASSERT_EQUAL_UINT32(3 * NEC_MIN_COMMAND_US, wave.totalUs);
+  // ...with well under two thirds of their LED on-time
+  TEST_ASSERT_LESS_THAN_UINT32(3 * frameMarkUs * 2 / 3, markUs(wave));
+}
+
+static void test_airtime_model_matches_encoded_frame() {
+  for (int i = 0; i < numCommands; i++) {
+    const IRCommand& cmd = irCommands[i];
+    if (cmd.protocol == IR_SHARP) {
+      continue; // Two frames per press, checked below
+    }
+    TEST_ASSERT_TRUE(irEncodeBurst(wave, cmd, 0, false));
+    // Everything up to the trailing gap is signal
+    uint32_t gapUs = cmd.protocol == IR_RC6 ? RC6_RPT_LENGTH_US : wave.durations[wave.count - 1];
+    TEST_ASSERT_EQUAL_UINT32(irFrameAirtimeUs(cmd), wave.totalUs - gapUs);
+  }
+
+  const IRCommand sharp = {IR_SHARP, 0xB54A, 15};
+  TEST_ASSERT_TRUE(irEncodeBurst(wave, sharp, 0, false));
+  TEST_ASSERT_EQUAL_UINT32(irFrameAirtimeUs(sharp), wave.totalUs - 2 * SHARP_GAP_US);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_frames_are_padded_to_protocol_spacing);
+  RUN_TEST(test_default_long_press_matches_baseline_per_code);
+  RUN_TEST(test_held_repeats_only_for_compact_repeat_protocols);
+  RUN_TEST(test_nec_repeats_cut_airtime_but_not_duration);
+  RUN_TEST(test_airtime_model_matches_encoded_frame);
+  return UNITY_END();
+}
@@ -0,0 +1,110 @@
+/*
+ * Request decisions of the resumable OTA endpoint: password, header
+ * parsing, resume offsets and which ranges start, continue or must be
+ * resent. The HTTP side is covered by tools/test_ota_upload.py.
+ */
+#include <string.h>
+#include <unity.h>
+#include "ota_session.h"
+
+static const char* const IMAGE_SHA =
+    "00112233445566778899aabbccddeeff00112233445566778899AABBCCDDEEFF";
+
+static uint8_t sha[OTA_SHA256_BYTES];
+static OtaSession session;
+
+void setUp() {
+  TEST_ASSERT_TRUE(otaParseSha256(IMAGE_SHA, sha));
+  memset(&session, 0, sizeof(session));
+}
+
+void tearDown() {}
+
+static void startSession(uint32_t size, uint32_t offset) {
+  session.active = true;
+  session.size = size;
+  session.offset = offset;
+  memcpy(session.sha256, sha, OTA_SHA256_BYTES);
+}
+
+static void test_password_must_match_exactly() {
+  TEST_ASSERT_TRUE(otaPasswordMatches("moana123", "moana123"));
+  TEST_ASSERT_FALSE(otaPasswordMatches("moana12", "moana123"));
+  TEST_ASSERT_FALSE(otaPasswordMatches("moana1234", "moana123"));
+  TEST_ASSERT_FALSE(otaPasswordMatches("Moana123", "moana123"));
+  TEST_ASSERT_FALSE(otaPasswordMatches("", "moana123"));
+}
+
+static void test_content_range_parsing() {
+  OtaRange range = {};
+  TEST_ASSERT_TRUE(otaParseContentRange("bytes 0-1023/4096", range));
+  TEST_ASSERT_EQUAL_UINT32(0, range.start);
+  TEST_ASSERT_EQUAL_UINT32(1024, range.end);
+  TEST_ASSERT_EQUAL_UINT32(4096, range.total);
+  TEST_ASSERT_TRUE(otaParseContentRange("bytes 4095-4095/4096", range));
+  TEST_ASSERT_EQUAL_UINT32(4096, range.end);
+
+  TEST_ASSERT_FALSE(otaParseContentRange("bytes 0-4096/4096", range)); // Past the end
+  TEST_ASSERT_FALSE(otaParseContentRange("bytes 10-9/4096", range));
+  TEST_ASSERT_FALSE(otaParseContentRange("bytes 0-9/*", range));
+  TEST_ASSERT_FALSE(otaParseContentRange("bytes 0-9", range));
+  TEST_ASSERT_FALSE(otaParseContentRange("items 0-9/10", range));
+}
+
+static void test_sha256_parsing() {
+  TEST_ASSERT_EQUAL_UINT8(0x00, sha[0]);
+  TEST_ASSERT_EQUAL_UINT8(0x11, sha[1]);
+  TEST_ASSERT_EQUAL_UINT8(0xFF, sha[31]);
+  uint8_t other[OTA_SHA256_BYTES];
+  TEST_ASSERT_FALSE(otaParseSha256("0011", other));
+  TEST_ASSERT_FALSE(otaParseSha256("zz112233445566778899aabbccddeeff00112233445566778899aabbccddeeff", other));
+}
+
+static void test_resume_offset_only_for_the_same_image() {
+  TEST_ASSERT_EQUAL_UINT32(0, otaSessionResumeOffset(session, 4096, sha));
+  startSession(4096, 2048);
+  TEST_ASSERT_EQUAL_UINT32(2048, otaSessionResumeOffset(session, 4096, sha));
+  TEST_ASSERT_EQUAL_UINT32(0, otaSessionResumeOffset(session, 4097, sha));
+  uint8_t other[OTA_SHA256_BYTES];
+  memcpy(other, sha, sizeof(other));
+  other[5] ^= 1;
+  TEST_ASSERT_EQUAL_UINT32(0, otaSessionResumeOffset(session, 4096, other));
+}
+
+static void test_range_decisions() {
+  OtaRange first = {0, 1024, 4096};
+  OtaRange next = {1024, 2048, 4096};
+  TEST_ASSERT_EQUAL(OTA_CHUNK_NEW_IMAGE, otaSessionCheck(session, first, sha));
+  TEST_ASSERT_EQUAL(OTA_CHUNK_OUT_OF_ORDER, otaSessionCheck(session, next, sha));
+
+  startSession(4096, 1024);
+  TEST_ASSERT_EQUAL(OTA_CHUNK_CONTINUE, otaSessionCheck(session, next, sha));
+  TEST_ASSERT_EQUAL(OTA_CHUNK_OUT_OF_ORDER, otaSessionCheck(session, first, sha)); // Already written
+
+  // A different image replaces the partial one, from its first byte only
+  OtaRange otherFirst = {0, 1024, 8192};
+  OtaRange otherNext = {1024, 2048, 8192};
+  TEST_ASSERT_EQUAL(OTA_CHUNK_NEW_IMAGE, otaSessionCheck(session, otherFirst, sha));
+  TEST_ASSERT_EQUAL(OTA_CHUNK_OUT_OF_ORDER, otaSessionCheck(session, otherNext, sha));
+}
+
+static void test_dropped_range_resumes_at_the_last_byte_received() {
+  // 600 bytes of a 1024 byte range arrived before the connection dropped
+  startSession(4096, 1024 + 600);
+  OtaRange resent = {1024, 2048, 4096};
+  TEST_ASSERT_EQUAL(OTA_CHUNK_OUT_OF_ORDER, otaSessionCheck(session, resent, sha));
+  uint32_t offset = otaSessionResumeOffset(session, 4096, sha);
+  OtaRange rest = {offset, 2048, 4096};
+  TEST_ASSERT_EQUAL(OTA_CHUNK_CONTINUE, otaSessionCheck(session, rest, sha));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_password_must_match_exactly);
+  RUN_TEST(test_content_range_parsing);
+  RUN_TEST(test_sha256_parsing);
+  RUN_TEST(test_resume_offset_only_for_the_same_image);
+  RUN_TEST(test_range_decisions);
+  RUN_TEST(test_dropped_range_resumes_at_the_last_byte_received);
+  return UNITY_END();
+}
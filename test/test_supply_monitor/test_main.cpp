@@ -0,0 +1,213 @@
+/*
+ * Loaded battery sampling and the drive control loop against simulated
+ * supply curves. The battery is an EMF behind a sag that follows the LED
+ * current with a first-order lag: it builds up during marks (in proportion
+ * to carrier duty) and recovers during spaces. Bursts come from the
+ * encoder, readings are averaged over SUPPLY_LOAD_READ_US like the ADC
+ * reading in the firmware.
+ */
+#include <math.h>
+#include <unity.h>
+#include "ir_codes.h"
+#include "ir_encoder.h"
+#include "ir_sweep.h"
+#include "supply_monitor.h"
+
+const double SAG_TAU_US = 80;
+const uint32_t READ_STEP_US = 10;
+
+struct Battery {
+  double emfMv;
+  double fullSagMv;    // Settled sag with the LED on at IR_DUTY_PERCENT
+};
+
+static IRWaveform wave;
+static SupplyMonitor monitor;
+
+void setUp() {
+  supplyMonitorInit(monitor, true, false);
+}
+
+void tearDown() {}
+
+static double settledSagMv(const Battery& battery, uint8_t dutyPercent) {
+  return battery.fullSagMv * dutyPercent / IR_DUTY_PERCENT;
+}
+
+// Sag tUs into the burst, starting from a rested battery
+static double sagAtMv(const Battery& battery, uint8_t dutyPercent, uint32_t tUs) {
+  double sag = 0;
+  double full = settledSagMv(battery, dutyPercent);
+  uint32_t elapsed = 0;
+  for (int i = 0; i < wave.count && elapsed < tUs; i++) {
+    uint32_t d = wave.durations[i];
+    if (elapsed + d > tUs) {
+      d = tUs - elapsed;
+    }
+    double target = (i % 2 == 0) ? full : 0;
+    sag = target + (sag - target) * exp(-(double)d / SAG_TAU_US);
+    elapsed += d;
+  }
+  return sag;
+}
+
+// Averaged reading starting offsetUs into the burst
+static double readingMv(const Battery& battery, uint8_t dutyPercent, uint32_t offsetUs) {
+  double sum = 0;
+  int n = 0;
+  for (uint32_t t = offsetUs; t < offsetUs + SUPPLY_LOAD_READ_US; t += READ_STEP_US) {
+    sum += battery.emfMv - sagAtMv(battery, dutyPercent, t);
+    n++;
+  }
+  return sum / n;
+}
+
+struct LoopResult {
+  double minTrueLoadMv;     // Lowest settled loaded voltage any burst saw
+  double maxReadingErrorMv; // Worst loaded reading against the settled one
+  uint32_t releasesWhileSagging;
+  uint32_t lastReleaseMs;
+  uint32_t minReleaseSpacingMs;
+};
+
+// Runs the sweep for durationMs from nowMs, sampling like the frame clock does
+static LoopResult runSweep(const Battery& battery, uint32_t& nowMs, uint32_t durationMs, bool sharpOnly) {
+  LoopResult result = {1e9, 0, 0, 0, 0xFFFFFFFF};
+  uint64_t nowUs = (uint64_t)nowMs * 1000;
+  uint32_t releaseAtMs = 0;
+  bool released = false;
+  int position = 0;
+  uint64_t endUs = nowUs + (uint64_t)durationMs * 1000;
+  while (nowUs < endUs) {
+    const IRCommand& cmd = sharpOnly ? irCommands[10] : irCommands[position];
+    position = (position + 1) % numCommands;
+    irEncodeBurst(wave, cmd, irBurstRepeats(cmd, DEFAULT_PACING, false), false);
+
+    const SupplyDrive& drive = supplyDrive(monitor);
+    uint8_t duty = drive.dutyPercent;
+    double trueLoadMv = battery.emfMv - settledSagMv(battery, duty);
+    if (trueLoadMv < result.minTrueLoadMv) {
+      result.minTrueLoadMv = trueLoadMv;
+    }
+
+    uint32_t now = (uint32_t)(nowUs / 1000);
+    uint32_t offsetUs = 0;
+    if (supplySampleDue(monitor, now) && supplyLoadedSampleOffset(wave, offsetUs)) {
+      double loadMv = readingMv(battery, duty, offsetUs);
+      double error = fabs(loadMv - trueLoadMv);
+      if (error > result.maxReadingErrorMv) {
+        result.maxReadingErrorMv = error;
+      }
+      SupplyDecision decision = supplyMonitorUpdate(monitor, (uint16_t)battery.emfMv, (uint16_t)loadMv, now);
+      if (decision == SUPPLY_RELEASE) {
+        if (trueLoadMv - SUPPLY_CRITICAL_MV < SUPPLY_RELEASE_MARGIN_MV) {
+          result.releasesWhileSagging++;
+        }
+        if (released && now - releaseAtMs < result.minReleaseSpacingMs) {
+          result.minReleaseSpacingMs = now - releaseAtMs;
+        }
+        released = true;
+        releaseAtMs = now;
+        result.lastReleaseMs = now;
+      }
+    }
+    nowUs += wave.totalUs + (uint64_t)(DEFAULT_PACING.frameGapMs + drive.extraGapMs) * 1000;
+  }
+  nowMs = (uint32_t)(nowUs / 1000);
+  return result;
+}
+
+static void test_loaded_sample_needs_a_long_mark() {
+  for (uint32_t c = 0; c < numCommands; c++) {
+    const IRCommand& cmd = irCommands[c];
+    irEncodeBurst(wave, cmd, irBurstRepeats(cmd, DEFAULT_PACING, false), false);
+    uint32_t offsetUs = 0;
+    bool found = supplyLoadedSampleOffset(wave, offsetUs);
+    if (cmd.protocol == IR_SHARP) {
+      TEST_ASSERT_FALSE(found);
+    } else {
+      // Every other protocol opens with its leader mark
+      TEST_ASSERT_TRUE(found);
+      TEST_ASSERT_EQUAL_UINT32(SUPPLY_LOAD_SETTLE_US, offsetUs);
+      TEST_ASSERT_GREATER_OR_EQUAL_UINT32(offsetUs + SUPPLY_LOAD_READ_US, wave.durations[0]);
+    }
+  }
+}
+
+static void test_reading_sees_the_settled_sag() {
+  const Battery battery = {3900, 400};
+  const IRCommand leaders[] = {irCommands[0], irCommands[3], irCommands[5], irCommands[8]};
+  for (const IRCommand& cmd : leaders) {
+    irEncodeBurst(wave, cmd, 0, false);
+    uint32_t offsetUs = 0;
+    TEST_ASSERT_TRUE(supplyLoadedSampleOffset(wave, offsetUs));
+    double sag = battery.emfMv - readingMv(battery, IR_DUTY_PERCENT, offsetUs);
+    TEST_ASSERT_TRUE(sag >= 0.95 * battery.fullSagMv);
+
+    // Reading straight at the start would catch the sag still building
+    double early = battery.emfMv - readingMv(battery, IR_DUTY_PERCENT, 0);
+    TEST_ASSERT_TRUE(early < 0.9 * battery.fullSagMv);
+  }
+
+  // A Sharp burst only has short marks: a reading averages over the spaces too
+  irEncodeBurst(wave, irCommands[10], 0, false);
+  double sharp = battery.emfMv - readingMv(battery, IR_DUTY_PERCENT, 0);
+  TEST_ASSERT_TRUE(sharp < 0.75 * battery.fullSagMv);
+}
+
+static void test_sharp_frames_never_feed_the_monitor() {
+  const Battery battery = {3700, 450};
+  uint32_t now = 0;
+  runSweep(battery, now, 5000, true);
+  TEST_ASSERT_EQUAL_UINT32(0, monitor.samples);
+  TEST_ASSERT_EQUAL_UINT8(0, monitor.level);
+}
+
+static void test_draining_battery_is_throttled_before_brownout() {
+  // Unthrottled, this battery ends well under the dropout voltage
+  TEST_ASSERT_LESS_THAN(SUPPLY_CRITICAL_MV, 3700 - 450);
+  uint32_t now = 0;
+  double worstMv = 1e9;
+  for (double emf = 4100; emf >= 3700; emf -= 10) {
+    const Battery battery = {emf, 450};
+    LoopResult result = runSweep(battery, now, 1000, false);
+    if (result.minTrueLoadMv < worstMv) {
+      worstMv = result.minTrueLoadMv;
+    }
+    TEST_ASSERT_TRUE(result.maxReadingErrorMv < 25.0);
+  }
+  TEST_ASSERT_TRUE(worstMv >= SUPPLY_CRITICAL_MV);
+  TEST_ASSERT_GREATER_THAN(0, monitor.throttles);
+  TEST_ASSERT_GREATER_THAN(2, monitor.level);
+}
+
+static void test_recovery_releases_one_step_at_a_time() {
+  uint32_t now = 0;
+  const Battery tired = {3750, 450};
+  LoopResult sagging = runSweep(tired, now, 10000, false);
+  uint8_t throttledLevel = monitor.level;
+  TEST_ASSERT_GREATER_THAN(0, throttledLevel);
+  TEST_ASSERT_EQUAL_UINT32(0, sagging.releasesWhileSagging);
+  TEST_ASSERT_EQUAL_UINT32(0, monitor.releases);
+
+  // Fresh cells: back to full drive, never faster than one level per hold time
+  uint32_t recoveredAtMs = now;
+  const Battery fresh = {4200, 250};
+  LoopResult recovering = runSweep(fresh, now, 30000, false);
+  TEST_ASSERT_EQUAL_UINT8(0, monitor.level);
+  TEST_ASSERT_EQUAL_UINT32(throttledLevel, monitor.releases);
+  TEST_ASSERT_EQUAL_UINT32(0, recovering.releasesWhileSagging);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(SUPPLY_RELEASE_HOLD_MS, recovering.minReleaseSpacingMs);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(recoveredAtMs + throttledLevel * SUPPLY_RELEASE_HOLD_MS,
+                                      recovering.lastReleaseMs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_loaded_sample_needs_a_long_mark);
+  RUN_TEST(test_reading_sees_the_settled_sag);
+  RUN_TEST(test_sharp_frames_never_feed_the_monitor);
+  RUN_TEST(test_draining_battery_is_throttled_before_brownout);
+  RUN_TEST(test_recovery_releases_one_step_at_a_time);
+  return UNITY_END();
+}
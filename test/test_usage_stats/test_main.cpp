@@ -0,0 +1,149 @@
+/*
+ * NVS flush policy of the usage counters against a simulated NVS backend.
+ * The backend stands in for nvsBlobSave(): it stores the blob, counts the
+ * writes and can be made to fail. The loop helpers call the policy the way
+ * serviceUsageStats() and onActivationEnd() do in the firmware.
+ */
+#include <string.h>
+#include <unity.h>
+#include "usage_stats.h"
+
+const uint32_t LOOP_MS = 10;
+
+struct FakeNvs {
+  UsageStats stored;
+  bool hasBlob;
+  bool failWrites;
+  uint32_t writes;       // Successful writes (flash wear)
+  uint32_t sweepWrites;  // Writes while a sweep was running
+};
+
+static FakeNvs nvs;
+static UsageTracker usage;
+static uint32_t now;
+
+void setUp() {
+  memset(&nvs, 0, sizeof(nvs));
+  memset(&usage, 0, sizeof(usage));
+  now = 1000;
+  usageTrackerStart(usage, now);
+}
+
+void tearDown() {}
+
+// flushUsageStats() with the fake backend
+static bool flush(DeviceState state) {
+  if (nvs.failWrites) {
+    return false;
+  }
+  nvs.stored = usage.stats;
+  nvs.hasBlob = true;
+  nvs.writes++;
+  if (state != STATE_IDLE) {
+    nvs.sweepWrites++;
+  }
+  usageTrackerFlushed(usage, now);
+  return true;
+}
+
+// Loop passes from now up to (not including) now + durationMs
+static void runLoop(DeviceState state, uint32_t durationMs) {
+  for (uint32_t end = now + durationMs; now != end; now += LOOP_MS) {
+    if (usageTrackerService(usage, state, now)) {
+      flush(state);
+    }
+  }
+}
+
+// A sweep with a burst every 100 ms, then the activation end flush
+static void runActivation(uint32_t durationMs) {
+  usageTrackerRecordPress(usage, false);
+  for (uint32_t end = now + durationMs; now != end; now += LOOP_MS) {
+    if (now % 100 == 0) {
+      usageTrackerRecordBurst(usage, (now / 100) % numCommands, 0);
+    }
+    if (usageTrackerService(usage, STATE_RUNNING_SHORT, now)) {
+      flush(STATE_RUNNING_SHORT);
+    }
+  }
+  if (usageTrackerActivationEndDue(usage, now)) {
+    flush(STATE_IDLE);
+  }
+}
+
+static void test_no_writes_during_a_sweep() {
+  runActivation(2 * STATS_TIME_FLUSH_INTERVAL_MS);
+  TEST_ASSERT_EQUAL_UINT32(0, nvs.sweepWrites);
+  TEST_ASSERT_EQUAL_UINT32(1, nvs.writes); // Only the activation end
+  TEST_ASSERT_FALSE(usage.dirty);
+}
+
+static void test_activation_end_flush_is_rate_limited() {
+  runLoop(STATE_IDLE, STATS_MIN_FLUSH_INTERVAL_MS);
+  runActivation(SHORT_PRESS_DURATION_MS);
+  TEST_ASSERT_EQUAL_UINT32(1, nvs.writes);
+
+  // Back-to-back activation: its events wait for the idle flush
+  runLoop(STATE_IDLE, 5000);
+  runActivation(SHORT_PRESS_DURATION_MS);
+  TEST_ASSERT_EQUAL_UINT32(1, nvs.writes);
+  TEST_ASSERT_TRUE(usage.dirty);
+
+  uint32_t lastFlush = usage.lastFlush;
+  runLoop(STATE_IDLE, STATS_FLUSH_INTERVAL_MS);
+  TEST_ASSERT_EQUAL_UINT32(2, nvs.writes);
+  TEST_ASSERT_EQUAL_UINT32(lastFlush + STATS_FLUSH_INTERVAL_MS, usage.lastFlush);
+  TEST_ASSERT_FALSE(usage.dirty);
+}
+
+static void test_idle_writes_only_the_hourly_time_counters() {
+  runLoop(STATE_IDLE, STATS_FLUSH_INTERVAL_MS + LOOP_MS); // Boot count
+  TEST_ASSERT_EQUAL_UINT32(1, nvs.writes);
+  runLoop(STATE_IDLE, 3 * STATS_TIME_FLUSH_INTERVAL_MS);
+  TEST_ASSERT_EQUAL_UINT32(4, nvs.writes);
+  TEST_ASSERT_EQUAL_UINT32(now - LOOP_MS - 1000, (uint32_t)nvs.stored.uptimeMs);
+}
+
+static void test_continuous_use_writes_at_most_every_min_interval() {
+  const uint32_t hourMs = 3600000;
+  for (uint32_t start = now; now - start < hourMs;) {
+    runActivation(SHORT_PRESS_DURATION_MS);
+    runLoop(STATE_IDLE, 10000);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, nvs.sweepWrites);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(hourMs / STATS_MIN_FLUSH_INTERVAL_MS + 1, nvs.writes);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(hourMs / STATS_FLUSH_INTERVAL_MS, nvs.writes);
+}
+
+static void test_failed_write_is_retried_and_nothing_is_lost() {
+  runLoop(STATE_IDLE, STATS_MIN_FLUSH_INTERVAL_MS);
+  nvs.failWrites = true;
+  runActivation(SHORT_PRESS_DURATION_MS);
+  runLoop(STATE_IDLE, STATS_FLUSH_INTERVAL_MS);
+  TEST_ASSERT_EQUAL_UINT32(0, nvs.writes);
+  TEST_ASSERT_TRUE(usage.dirty);
+
+  nvs.failWrites = false;
+  runLoop(STATE_IDLE, LOOP_MS);
+  TEST_ASSERT_EQUAL_UINT32(1, nvs.writes);
+  TEST_ASSERT_EQUAL_MEMORY(&usage.stats, &nvs.stored, sizeof(UsageStats));
+
+  // Reboot: the stored blob is loaded and the new boot counted
+  UsageTracker rebooted;
+  memset(&rebooted, 0, sizeof(rebooted));
+  rebooted.stats = nvs.stored;
+  usageTrackerStart(rebooted, 0);
+  TEST_ASSERT_EQUAL_UINT32(2, rebooted.stats.bootCount);
+  TEST_ASSERT_EQUAL_UINT32(1, rebooted.stats.shortPresses);
+  TEST_ASSERT_EQUAL_UINT32(SHORT_PRESS_DURATION_MS / 100, (uint32_t)rebooted.stats.stateTimeMs[STATE_RUNNING_SHORT] / 100);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_no_writes_during_a_sweep);
+  RUN_TEST(test_activation_end_flush_is_rate_limited);
+  RUN_TEST(test_idle_writes_only_the_hourly_time_counters);
+  RUN_TEST(test_continuous_use_writes_at_most_every_min_interval);
+  RUN_TEST(test_failed_write_is_retried_and_nothing_is_lost);
+  return UNITY_END();
+}
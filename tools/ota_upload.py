@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Resumable firmware upload to the oar in Demo/OTA mode.
+
+Connect to the "REMO MAGICO!" access point first. The image is sent in
+ranges; when the connection drops, the device is asked how much it already
+has and only the rest is sent again. The device switches to the new image
+only once all of it has arrived and its SHA-256 matches. Every request
+carries the OTA password (--auth, the access point password by default).
+
+    python3 tools/ota_upload.py .pio/build/esp32-c3-devkitm-1/firmware.bin
+"""
+
+import argparse
+import hashlib
+import http.client
+import sys
+import time
+
+
+DEFAULT_PASSWORD = "moana123"
+
+
+def query_offset(host, port, size, sha, password, timeout):
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        conn.request("GET", "/update", headers={
+            "X-Image-Size": str(size),
+            "X-SHA256": sha,
+            "X-OTA-Password": password,
+        })
+        resp = conn.getresponse()
+        body = resp.read().decode().strip()
+        if resp.status == 401:
+            raise RuntimeError("device rejected the OTA password (--auth)")
+        if resp.status != 200:
+            raise RuntimeError("offset query failed: %d %s" % (resp.status, body))
+        return int(body)
+    finally:
+        conn.close()
+
+
+def send_range(host, port, image, start, end, sha, password, timeout):
+    """Sends image[start:end], returns the device's offset afterwards."""
+    conn = http.client.HTTPConnection(host, port, timeout=timeout)
+    try:
+        conn.request("POST", "/update", body=image[start:end], headers={
+            "Content-Type": "application/octet-stream",
+            "Content-Range": "bytes %d-%d/%d" % (start, end - 1, len(image)),
+            "X-SHA256": sha,
+            "X-OTA-Password": password,
+        })
+        resp = conn.getresponse()
+        body = resp.read().decode().strip()
+        if resp.status == 401:
+            raise RuntimeError("device rejected the OTA password (--auth)")
+        if resp.status in (200, 416):
+            return int(body)
+        raise RuntimeError("upload failed: %d %s" % (resp.status, body))
+    finally:
+        conn.close()
+
+
+def upload(image, host, port, password, chunk=64 * 1024, retries=20, timeout=15.0, retry_delay=2.0):
+    """Sends the whole image, resuming after dropped connections. Returns 0 on success."""
+    sha = hashlib.sha256(image).hexdigest()
+    size = len(image)
+
+    failures = 0
+    offset = None
+    while True:
+        try:
+            if offset is None:
+                offset = query_offset(host, port, size, sha, password, timeout)
+                if offset:
+                    print("Resuming at %d bytes" % offset)
+            end = min(offset + chunk, size)
+            offset = send_range(host, port, image, offset, end, sha, password, timeout)
+            failures = 0
+            print("\r%3d%%" % (offset * 100 // size), end="", flush=True)
+            if offset == size:
+                print("\nImage verified, device is rebooting")
+                return 0
+        except (OSError, http.client.HTTPException) as e:
+            failures += 1
+            if failures > retries:
+                print("\nGiving up: %s" % e, file=sys.stderr)
+                return 1
+            print("\nConnection lost (%s), reconnecting..." % e)
+            offset = None
+            time.sleep(retry_delay)
+        except RuntimeError as e:
+            print("\n%s" % e, file=sys.stderr)
+            return 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("image", help="firmware.bin to upload")
+    parser.add_argument("--host", default="192.168.4.1")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--auth", default=DEFAULT_PASSWORD, help="OTA password (OTA_PASSWORD in board.h)")
+    parser.add_argument("--chunk", type=int, default=64 * 1024, help="bytes per request")
+    parser.add_argument("--retries", type=int, default=20, help="reconnects before giving up")
+    parser.add_argument("--timeout", type=float, default=15.0)
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    print("Uploading %s (%d bytes, sha256 %s)" % (args.image, len(image), hashlib.sha256(image).hexdigest()))
+    return upload(image, args.host, args.port, args.auth, args.chunk, args.retries, args.timeout)
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Loopback test of tools/ota_upload.py against a stand-in for the device.
+
+The stand-in serves GET/POST /update like lib/moana_esp/src/ota_http.cpp:
+same headers, password check, resume offsets and range decisions
+(otaSessionCheck), and it cuts connections at random points mid-body the
+way the soft AP drops its client. No hardware needed:
+
+    python3 tools/test_ota_upload.py
+"""
+
+import hashlib
+import http.server
+import os
+import random
+import socket
+import sys
+import threading
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import ota_upload  # noqa: E402
+
+PASSWORD = ota_upload.DEFAULT_PASSWORD
+CHUNK = 4096
+
+
+class StandInDevice:
+    """Session state of ota_session.h plus what the device ends up booting."""
+
+    def __init__(self, drop_chance):
+        self.drop_chance = drop_chance
+        self.rng = random.Random(1)
+        self.active = False
+        self.size = 0
+        self.sha = ""
+        self.written = bytearray()
+        self.booted = None
+        self.received = 0
+        self.offered = 0
+        self.drops = 0
+        self.rejected = 0
+
+    def resume_offset(self, size, sha):
+        return len(self.written) if self.active and self.size == size and self.sha == sha else 0
+
+
+def make_handler(device):
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def log_message(self, *args):
+            pass
+
+        def reply(self, status, body):
+            data = body.encode()
+            self.send_response(status)
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+
+        def authorized(self):
+            if self.headers.get("X-OTA-Password") == PASSWORD:
+                return True
+            device.rejected += 1
+            self.close_connection = True
+            self.reply(401, "Need X-OTA-Password\n")
+            return False
+
+        def do_GET(self):
+            if not self.authorized():
+                return
+            size = int(self.headers["X-Image-Size"])
+            self.reply(200, "%d\n" % device.resume_offset(size, self.headers["X-SHA256"]))
+
+        def do_POST(self):
+            if not self.authorized():
+                return
+            sha = self.headers["X-SHA256"]
+            first, rest = self.headers["Content-Range"][len("bytes "):].split("-")
+            last, total = (int(v) for v in rest.split("/"))
+            start, end = int(first), last + 1
+            length = int(self.headers["Content-Length"])
+            device.offered += length
+            if end - start != length:
+                self.close_connection = True
+                self.reply(400, "Bad image size\n")
+                return
+
+            matches = device.active and device.size == total and device.sha == sha
+            if (matches and start != len(device.written)) or (not matches and start != 0):
+                self.close_connection = True
+                self.reply(416, "%d\n" % device.resume_offset(total, sha))
+                return
+            if not matches:
+                device.active, device.size, device.sha = True, total, sha
+                device.written = bytearray()
+
+            # Everything read before a drop stays written
+            cut = length
+            if device.rng.random() < device.drop_chance:
+                cut = device.rng.randrange(length)
+            while len(device.written) < start + cut:
+                data = self.rfile.read(min(1024, start + cut - len(device.written)))
+                if not data:
+                    return
+                device.written += data
+                device.received += len(data)
+            if cut < length:
+                device.drops += 1
+                self.close_connection = True
+                self.connection.shutdown(socket.SHUT_RDWR)
+                return
+
+            if len(device.written) == device.size:
+                device.active = False
+                if hashlib.sha256(device.written).hexdigest() == device.sha:
+                    device.booted = bytes(device.written)
+                else:
+                    self.reply(500, "Update failed\n")
+                    return
+            self.reply(200, "%d\n" % len(device.written))
+
+    return Handler
+
+
+class OtaUploadTest(unittest.TestCase):
+    def start_device(self, drop_chance):
+        device = StandInDevice(drop_chance)
+        server = http.server.HTTPServer(("127.0.0.1", 0), make_handler(device))
+        thread = threading.Thread(target=server.serve_forever, daemon=True)
+        thread.start()
+        self.addCleanup(server.server_close)
+        self.addCleanup(server.shutdown)
+        return device, server.server_address[1]
+
+    def upload(self, port, image, password=PASSWORD):
+        with open(os.devnull, "w") as quiet:
+            stdout, stderr = sys.stdout, sys.stderr
+            sys.stdout = sys.stderr = quiet
+            try:
+                return ota_upload.upload(image, "127.0.0.1", port, password, chunk=CHUNK,
+                                         retries=50, timeout=5.0, retry_delay=0)
+            finally:
+                sys.stdout, sys.stderr = stdout, stderr
+
+    def test_clean_link_uploads_the_image(self):
+        device, port = self.start_device(0.0)
+        image = os.urandom(10 * CHUNK + 123)
+        self.assertEqual(0, self.upload(port, image))
+        self.assertEqual(image, device.booted)
+        self.assertEqual(len(image), device.received)
+
+    def test_dropped_connections_resume_without_resending(self):
+        device, port = self.start_device(0.3)
+        image = os.urandom(40 * CHUNK + 7)
+        self.assertEqual(0, self.upload(port, image))
+        self.assertEqual(image, device.booted)
+        self.assertGreater(device.drops, 0)
+        # A drop costs at most the rest of its range: the client resumes at the device's offset
+        self.assertEqual(len(image), device.received)
+        self.assertLessEqual(device.offered, len(image) + device.drops * CHUNK)
+
+    def test_wrong_password_writes_nothing(self):
+        device, port = self.start_device(0.0)
+        self.assertEqual(1, self.upload(port, os.urandom(CHUNK), password="wrong"))
+        self.assertIsNone(device.booted)
+        self.assertEqual(0, device.received)
+        self.assertEqual(1, device.rejected)
+
+    def test_new_image_replaces_a_partial_one(self):
+        device, port = self.start_device(0.0)
+        stale = os.urandom(8 * CHUNK)
+        device.active, device.size, device.sha = True, len(stale), hashlib.sha256(stale).hexdigest()
+        device.written = bytearray(stale[:3 * CHUNK])
+        image = os.urandom(5 * CHUNK)
+        self.assertEqual(0, self.upload(port, image))
+        self.assertEqual(image, device.booted)
+
+
+if __name__ == "__main__":
+    unittest.main()